@@ -0,0 +1,871 @@
+/*** arrow.c -- Arrow IPC streams of flat columns
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "arrow.h"
+#include "boobs.h"
+#include "nifty.h"
+
+/* message header types, Schema.fbs and Message.fbs */
+#define MSG_SCHEMA	1U
+#define MSG_DICT	2U
+#define MSG_BATCH	3U
+#define METADATA_V4	3U
+#define METADATA_V5	4U
+
+/* type union */
+#define TYPE_NULL	1U
+#define TYPE_INT	2U
+#define TYPE_FLOAT	3U
+#define TYPE_BINARY	4U
+#define TYPE_UTF8	5U
+#define TYPE_BOOL	6U
+#define TYPE_DECIMAL	7U
+#define TYPE_DATE	8U
+#define TYPE_TIME	9U
+#define TYPE_TS		10U
+#define TYPE_INTERVAL	11U
+#define TYPE_FSBINARY	15U
+#define TYPE_DURATION	18U
+#define TYPE_LBINARY	19U
+#define TYPE_LUTF8	20U
+
+#define PRECISION_DOUBLE	2U
+#define UNIT_MILLI		1U
+
+/* sanity limits for what we read */
+#define MAX_META	(1U << 24U)
+#define MAX_BODY	(1ULL << 40U)
+
+/* flatbuffers positions, 0 is the root offset and never a table */
+#define NIL	((size_t)0U)
+
+
+static int
+buf_grow(arrow_buf_t *b, size_t n)
+{
+	if (UNLIKELY(b->n + n > b->z)) {
+		size_t nuz = (b->z * 2U) ?: 4096U;
+		uint8_t *nu;
+
+		for (; nuz < b->n + n; nuz *= 2U);
+		if (UNLIKELY((nu = realloc(b->b, nuz)) == NULL)) {
+			return -1;
+		}
+		b->b = nu;
+		b->z = nuz;
+	}
+	return 0;
+}
+
+static int
+buf_add(arrow_buf_t *b, const void *p, size_t n)
+{
+	if (UNLIKELY(buf_grow(b, n) < 0)) {
+		return -1;
+	}
+	memcpy(b->b + b->n, p, n);
+	b->n += n;
+	return 0;
+}
+
+static inline uint16_t
+rd16(const uint8_t *p)
+{
+	uint16_t x;
+	memcpy(&x, p, sizeof(x));
+	return le16toh(x);
+}
+
+static inline uint32_t
+rd32(const uint8_t *p)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof(x));
+	return le32toh(x);
+}
+
+static inline uint64_t
+rd64(const uint8_t *p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof(x));
+	return le64toh(x);
+}
+
+
+/* column building */
+static int
+push_valid(arrow_wcol_t *c, bool v)
+{
+	arrow_buf_t *b = c->buf + 0U;
+	const size_t i = c->nrow;
+
+	if (!(i % 8U)) {
+		if (UNLIKELY(buf_grow(b, 1U) < 0)) {
+			return -1;
+		}
+		b->b[b->n++] = 0U;
+	}
+	b->b[i / 8U] |= (uint8_t)(v << (i % 8U));
+	c->nnul += !v;
+	c->nrow++;
+	return 0;
+}
+
+static int
+push_off(arrow_wcol_t *c)
+{
+	uint32_t o;
+
+	if (!c->buf[1U].n) {
+		/* offsets start out at 0 */
+		o = 0U;
+		if (UNLIKELY(buf_add(c->buf + 1U, &o, sizeof(o)) < 0)) {
+			return -1;
+		}
+	}
+	o = htole32((uint32_t)c->buf[2U].n);
+	return buf_add(c->buf + 1U, &o, sizeof(o));
+}
+
+int
+arrow_push_utf8(arrow_wcol_t *c, const char *s, size_t n)
+{
+	if (UNLIKELY(c->buf[2U].n + n > INT32_MAX)) {
+		return -1;
+	} else if (UNLIKELY(buf_add(c->buf + 2U, s, n) < 0)) {
+		return -1;
+	} else if (UNLIKELY(push_off(c) < 0)) {
+		return -1;
+	}
+	return push_valid(c, true);
+}
+
+int
+arrow_push_f64(arrow_wcol_t *c, double x)
+{
+	uint64_t u;
+
+	memcpy(&u, &x, sizeof(u));
+	u = htole64(u);
+	if (UNLIKELY(buf_add(c->buf + 1U, &u, sizeof(u)) < 0)) {
+		return -1;
+	}
+	return push_valid(c, true);
+}
+
+int
+arrow_push_ts(arrow_wcol_t *c, int64_t ms)
+{
+	uint64_t u = htole64((uint64_t)ms);
+
+	if (UNLIKELY(buf_add(c->buf + 1U, &u, sizeof(u)) < 0)) {
+		return -1;
+	}
+	return push_valid(c, true);
+}
+
+int
+arrow_push_nul(arrow_wcol_t *c)
+{
+	/* nulls still take a slot */
+	if (c->type == ARROW_UTF8) {
+		if (UNLIKELY(push_off(c) < 0)) {
+			return -1;
+		}
+	} else if (UNLIKELY(buf_add(c->buf + 1U, &(uint64_t){0U}, 8U) < 0)) {
+		return -1;
+	}
+	return push_valid(c, false);
+}
+
+void
+arrow_wcol_free(arrow_wcol_t *c, size_t nc)
+{
+	for (size_t i = 0U; i < nc; i++) {
+		for (size_t j = 0U; j < countof(c[i].buf); j++) {
+			free(c[i].buf[j].b);
+			c[i].buf[j] = (arrow_buf_t){NULL};
+		}
+		c[i].nrow = c[i].nnul = 0U;
+	}
+	return;
+}
+
+
+/* flatbuffers, built front to back so that offsets always point
+ * forward, the caller makes room for the whole message beforehand */
+static size_t
+fb_room(arrow_buf_t *f, size_t n, size_t align)
+{
+/* pad F to ALIGN, append N zero bytes and return their position */
+	size_t p;
+
+	for (; f->n % align; f->b[f->n++] = 0U);
+	p = f->n;
+	memset(f->b + p, 0, n);
+	f->n += n;
+	return p;
+}
+
+static inline void
+fb_u8(arrow_buf_t *f, size_t at, uint8_t x)
+{
+	f->b[at] = x;
+}
+
+static inline void
+fb_u16(arrow_buf_t *f, size_t at, uint16_t x)
+{
+	x = htole16(x);
+	memcpy(f->b + at, &x, sizeof(x));
+}
+
+static inline void
+fb_u32(arrow_buf_t *f, size_t at, uint32_t x)
+{
+	x = htole32(x);
+	memcpy(f->b + at, &x, sizeof(x));
+}
+
+static inline void
+fb_u64(arrow_buf_t *f, size_t at, uint64_t x)
+{
+	x = htole64(x);
+	memcpy(f->b + at, &x, sizeof(x));
+}
+
+static inline void
+fb_ref(arrow_buf_t *f, size_t at, size_t to)
+{
+	fb_u32(f, at, (uint32_t)(to - at));
+}
+
+static size_t
+fb_table(arrow_buf_t *f, const uint16_t *offs, size_t nfld, size_t tsz)
+{
+/* write a vtable with field offsets OFFS (0 for absent fields),
+ * followed by the table of TSZ bytes, return the table's position */
+	const size_t vt = fb_room(f, 4U + 2U * nfld, 2U);
+	size_t t;
+
+	fb_u16(f, vt + 0U, (uint16_t)(4U + 2U * nfld));
+	fb_u16(f, vt + 2U, (uint16_t)tsz);
+	for (size_t i = 0U; i < nfld; i++) {
+		fb_u16(f, vt + 4U + 2U * i, offs[i]);
+	}
+	t = fb_room(f, tsz, 8U);
+	fb_u32(f, t, (uint32_t)(t - vt));
+	return t;
+}
+
+static size_t
+fb_str(arrow_buf_t *f, const char *s)
+{
+	const size_t n = strlen(s);
+	const size_t p = fb_room(f, 4U + n + 1U, 4U);
+
+	fb_u32(f, p, (uint32_t)n);
+	memcpy(f->b + p + 4U, s, n);
+	return p;
+}
+
+static size_t
+fb_svec(arrow_buf_t *f, size_t n, size_t elz)
+{
+/* vector of N structs of ELZ bytes, elements 8-aligned */
+	size_t p;
+
+	for (; (f->n + 4U) % 8U; f->b[f->n++] = 0U);
+	p = fb_room(f, 4U + n * elz, 4U);
+	fb_u32(f, p, (uint32_t)n);
+	return p;
+}
+
+static size_t
+fb_msg(arrow_buf_t *f, unsigned int type, uint64_t bodyz)
+{
+/* Message table, the header reference goes to the result + 8U */
+	static const uint16_t offs[] = {6U, 4U, 8U, 16U};
+	size_t m;
+
+	/* root offset */
+	fb_room(f, 4U, 4U);
+	m = fb_table(f, offs, countof(offs), 24U);
+	fb_ref(f, 0U, m);
+	fb_u16(f, m + 6U, METADATA_V5);
+	fb_u8(f, m + 4U, (uint8_t)type);
+	fb_u64(f, m + 16U, bodyz);
+	return m;
+}
+
+static void
+wr_msg(void(*out)(const char*, size_t), arrow_buf_t *f)
+{
+/* continuation marker and metadata size, padded so bodies align */
+	uint32_t hdr[2U];
+
+	for (; f->n % 8U; f->b[f->n++] = 0U);
+	hdr[0U] = 0xffffffffU;
+	hdr[1U] = htole32((uint32_t)f->n);
+	out((const char*)hdr, sizeof(hdr));
+	out((const char*)f->b, f->n);
+	return;
+}
+
+int
+arrow_wr_schema(void(*out)(const char*, size_t),
+		const arrow_wcol_t *c, size_t nc)
+{
+	static const uint16_t sch_offs[] = {0U, 4U};
+	/* name, nullable, type_type, type, dictionary, children */
+	static const uint16_t fld_offs[] = {4U, 16U, 17U, 8U, 0U, 12U};
+	static const uint16_t flt_offs[] = {4U};
+	static const uint16_t ts_offs[] = {8U, 4U};
+	arrow_buf_t f = {NULL};
+	size_t z = 256U;
+	size_t m, s, v;
+
+	for (size_t i = 0U; i < nc; i++) {
+		z += 192U + strlen(c[i].name);
+	}
+	if (UNLIKELY(buf_grow(&f, z) < 0)) {
+		return -1;
+	}
+	m = fb_msg(&f, MSG_SCHEMA, 0U);
+	s = fb_table(&f, sch_offs, countof(sch_offs), 8U);
+	fb_ref(&f, m + 8U, s);
+	v = fb_room(&f, 4U + 4U * nc, 4U);
+	fb_u32(&f, v, (uint32_t)nc);
+	fb_ref(&f, s + 4U, v);
+	for (size_t i = 0U; i < nc; i++) {
+		const size_t fld = fb_table(&f, fld_offs, countof(fld_offs), 20U);
+		size_t t;
+
+		fb_ref(&f, v + 4U + 4U * i, fld);
+		fb_ref(&f, fld + 4U, fb_str(&f, c[i].name));
+		fb_u8(&f, fld + 16U, 1U);
+		switch (c[i].type) {
+		case ARROW_UTF8:
+			fb_u8(&f, fld + 17U, TYPE_UTF8);
+			t = fb_table(&f, NULL, 0U, 4U);
+			break;
+		case ARROW_F64:
+			fb_u8(&f, fld + 17U, TYPE_FLOAT);
+			t = fb_table(&f, flt_offs, countof(flt_offs), 8U);
+			fb_u16(&f, t + 4U, PRECISION_DOUBLE);
+			break;
+		case ARROW_TS:
+		default:
+			fb_u8(&f, fld + 17U, TYPE_TS);
+			t = fb_table(&f, ts_offs, countof(ts_offs), 12U);
+			fb_u16(&f, t + 8U, UNIT_MILLI);
+			fb_ref(&f, t + 4U, fb_str(&f, "UTC"));
+			break;
+		}
+		fb_ref(&f, fld + 8U, t);
+		/* readers insist on children, even if there are none */
+		fb_ref(&f, fld + 12U, fb_room(&f, 4U, 4U));
+	}
+	wr_msg(out, &f);
+	free(f.b);
+	return 0;
+}
+
+static inline size_t
+wcol_nbuf(const arrow_wcol_t *c)
+{
+	return 2U + (c->type == ARROW_UTF8);
+}
+
+static inline size_t
+wcol_blen(const arrow_wcol_t *c, size_t j)
+{
+	/* no validity bitmap without nulls */
+	return !j && !c->nnul ? 0U : c->buf[j].n;
+}
+
+int
+arrow_wr_batch(void(*out)(const char*, size_t), arrow_wcol_t *c, size_t nc)
+{
+	static const uint16_t rb_offs[] = {16U, 4U, 8U};
+	static const char pad[8U];
+	arrow_buf_t f = {NULL};
+	const size_t nrow = nc ? c[0U].nrow : 0U;
+	size_t nbuf = 0U;
+	size_t m, r, nv, bv;
+	uint64_t off = 0U;
+
+	for (size_t i = 0U; i < nc; i++) {
+		if (UNLIKELY(c[i].nrow != nrow)) {
+			return -1;
+		} else if (c[i].type == ARROW_UTF8 && !c[i].buf[1U].n &&
+			   UNLIKELY(buf_add(c[i].buf + 1U,
+					    &(uint32_t){0U}, 4U) < 0)) {
+			/* empty columns still have their first offset */
+			return -1;
+		}
+		nbuf += wcol_nbuf(c + i);
+	}
+	if (UNLIKELY(buf_grow(&f, 256U + 16U * (nc + nbuf)) < 0)) {
+		return -1;
+	}
+	m = fb_msg(&f, MSG_BATCH, 0U);
+	r = fb_table(&f, rb_offs, countof(rb_offs), 24U);
+	fb_ref(&f, m + 8U, r);
+	fb_u64(&f, r + 16U, nrow);
+	nv = fb_svec(&f, nc, 16U);
+	fb_ref(&f, r + 4U, nv);
+	for (size_t i = 0U; i < nc; i++) {
+		fb_u64(&f, nv + 4U + 16U * i + 0U, c[i].nrow);
+		fb_u64(&f, nv + 4U + 16U * i + 8U, c[i].nnul);
+	}
+	bv = fb_svec(&f, nbuf, 16U);
+	fb_ref(&f, r + 8U, bv);
+	for (size_t i = 0U, k = 0U; i < nc; i++) {
+		for (size_t j = 0U; j < wcol_nbuf(c + i); j++, k++) {
+			const size_t len = wcol_blen(c + i, j);
+
+			fb_u64(&f, bv + 4U + 16U * k + 0U, off);
+			fb_u64(&f, bv + 4U + 16U * k + 8U, len);
+			off += (len + 7U) & ~(size_t)7U;
+		}
+	}
+	fb_u64(&f, m + 16U, off);
+	wr_msg(out, &f);
+	free(f.b);
+
+	/* body, buffers padded to 8 bytes */
+	for (size_t i = 0U; i < nc; i++) {
+		for (size_t j = 0U; j < wcol_nbuf(c + i); j++) {
+			const size_t len = wcol_blen(c + i, j);
+
+			out((const char*)c[i].buf[j].b, len);
+			out(pad, -len % 8U);
+		}
+		/* and reset for the next batch */
+		for (size_t j = 0U; j < countof(c[i].buf); j++) {
+			c[i].buf[j].n = 0U;
+		}
+		c[i].nrow = c[i].nnul = 0U;
+	}
+	return 0;
+}
+
+void
+arrow_wr_eos(void(*out)(const char*, size_t))
+{
+	static const char eos[] = "\377\377\377\377\0\0\0";
+
+	out(eos, sizeof(eos));
+	return;
+}
+
+
+/* reading, all positions are checked against the metadata's size */
+static size_t
+fbr_ref(const arrow_buf_t *m, size_t p)
+{
+/* follow the offset at P */
+	size_t o;
+
+	if (p == NIL || p + 4U > m->n) {
+		return NIL;
+	}
+	o = p + rd32(m->b + p);
+	return o > p && o < m->n ? o : NIL;
+}
+
+static size_t
+fbr_fld(const arrow_buf_t *m, size_t t, unsigned int id, size_t z)
+{
+/* position of field ID (Z bytes wide) of table T, NIL if absent */
+	int64_t so;
+	size_t vt, vz, o;
+
+	if (t == NIL || t + 4U > m->n) {
+		return NIL;
+	} else if ((so = (int64_t)t - (int32_t)rd32(m->b + t)) < 0) {
+		return NIL;
+	} else if ((vt = (size_t)so) + 4U > m->n) {
+		return NIL;
+	}
+	vz = rd16(m->b + vt);
+	if (4U + 2U * id + 2U > vz || vt + 4U + 2U * id + 2U > m->n) {
+		return NIL;
+	}
+	o = rd16(m->b + vt + 4U + 2U * id);
+	if (!o || t + o + z > m->n) {
+		return NIL;
+	}
+	return t + o;
+}
+
+static uint64_t
+fbr_scal(const arrow_buf_t *m, size_t t, unsigned int id, size_t z, uint64_t d)
+{
+/* scalar field ID of width Z of table T, D if absent */
+	const size_t p = fbr_fld(m, t, id, z);
+
+	if (p == NIL) {
+		return d;
+	}
+	switch (z) {
+	case 1U:
+		return m->b[p];
+	case 2U:
+		return rd16(m->b + p);
+	case 4U:
+		return rd32(m->b + p);
+	default:
+		return rd64(m->b + p);
+	}
+}
+
+static size_t
+fbr_vec(const arrow_buf_t *m, size_t t, unsigned int id, size_t elz, size_t *n)
+{
+/* elements of vector field ID of table T, their number in N */
+	const size_t v = fbr_ref(m, fbr_fld(m, t, id, 4U));
+
+	if (v == NIL || v + 4U > m->n) {
+		return NIL;
+	}
+	*n = rd32(m->b + v);
+	if (*n > (m->n - v - 4U) / elz) {
+		return NIL;
+	}
+	return v + 4U;
+}
+
+static int
+rd_msg(arrow_rd_t *rd, unsigned int *type, size_t *hdr)
+{
+/* read the next message, return 0 at the end of the stream */
+	uint32_t x;
+	size_t mz, msg;
+	uint64_t bz;
+
+	if (fread(&x, sizeof(x), 1U, rd->fp) < 1U) {
+		/* be lenient about missing end-of-stream markers */
+		return feof(rd->fp) ? 0 : -1;
+	} else if (x == 0xffffffffU &&
+		   fread(&x, sizeof(x), 1U, rd->fp) < 1U) {
+		return -1;
+	} else if (!(mz = le32toh(x))) {
+		/* end of stream */
+		return 0;
+	} else if (UNLIKELY(mz < 8U || mz > MAX_META)) {
+		return -1;
+	}
+	rd->meta.n = 0U;
+	if (UNLIKELY(buf_grow(&rd->meta, mz) < 0)) {
+		return -1;
+	} else if (UNLIKELY(fread(rd->meta.b, 1U, mz, rd->fp) < mz)) {
+		return -1;
+	}
+	rd->meta.n = mz;
+
+	if ((msg = rd32(rd->meta.b)) < 4U || msg >= mz) {
+		return -1;
+	} else if (fbr_scal(&rd->meta, msg, 0U, 2U, 0U) < METADATA_V4) {
+		/* ancient stuff */
+		return -1;
+	}
+	*type = fbr_scal(&rd->meta, msg, 1U, 1U, 0U);
+	*hdr = fbr_ref(&rd->meta, fbr_fld(&rd->meta, msg, 2U, 4U));
+	bz = fbr_scal(&rd->meta, msg, 3U, 8U, 0U);
+
+	if (UNLIKELY(bz > MAX_BODY)) {
+		return -1;
+	}
+	rd->body.n = 0U;
+	/* never leave the body unallocated */
+	if (UNLIKELY(buf_grow(&rd->body, bz + 8U) < 0)) {
+		return -1;
+	} else if (UNLIKELY(fread(rd->body.b, 1U, bz, rd->fp) < bz)) {
+		return -1;
+	}
+	rd->body.n = bz;
+	return 1;
+}
+
+int
+arrow_rd_open(arrow_rd_t *rd, FILE *fp)
+{
+	const arrow_buf_t *m = &rd->meta;
+	unsigned int type;
+	size_t hdr, fv, nf;
+
+	*rd = (arrow_rd_t){.fp = fp};
+	if (rd_msg(rd, &type, &hdr) <= 0 || type != MSG_SCHEMA) {
+		return -1;
+	} else if ((fv = fbr_vec(m, hdr, 1U, 4U, &nf)) == NIL) {
+		return -1;
+	} else if (UNLIKELY((rd->col = calloc(nf, sizeof(*rd->col))) == NULL)) {
+		return -1;
+	}
+	rd->ncol = nf;
+	for (size_t i = 0U; i < nf; i++) {
+		const size_t fld = fbr_ref(m, fv + 4U * i);
+		const size_t ty = fbr_ref(m, fbr_fld(m, fld, 3U, 4U));
+		arrow_rcol_t *c = rd->col + i;
+		size_t s, n = 0U;
+
+		if (fld == NIL) {
+			return -1;
+		} else if ((s = fbr_vec(m, fld, 0U, 1U, &n)) == NIL) {
+			s = 0U, n = 0U;
+		}
+		if (UNLIKELY((c->name = strndup((const char*)m->b + s, n)) == NULL)) {
+			return -1;
+		}
+		if (fbr_fld(m, fld, 4U, 4U) != NIL) {
+			/* dictionary encoded */
+			return -1;
+		} else if (fbr_vec(m, fld, 5U, 4U, &n) != NIL && n) {
+			/* nested */
+			return -1;
+		}
+		switch (fbr_scal(m, fld, 2U, 1U, 0U)) {
+		case TYPE_NULL:
+			c->type = ARROW_OTHER;
+			c->nbuf = 0U;
+			break;
+		case TYPE_UTF8:
+			c->type = ARROW_UTF8;
+			c->nbuf = 3U;
+			break;
+		case TYPE_LUTF8:
+			c->type = ARROW_LUTF8;
+			c->nbuf = 3U;
+			break;
+		case TYPE_BINARY:
+		case TYPE_LBINARY:
+			c->type = ARROW_OTHER;
+			c->nbuf = 3U;
+			break;
+		case TYPE_FLOAT:
+			c->type = fbr_scal(m, ty, 0U, 2U, 0U) == PRECISION_DOUBLE
+				? ARROW_F64 : ARROW_OTHER;
+			c->nbuf = 2U;
+			break;
+		case TYPE_TS:
+			c->type = ARROW_TS;
+			c->unit = fbr_scal(m, ty, 0U, 2U, 0U);
+			c->nbuf = 2U;
+			if (UNLIKELY(c->unit > 3U)) {
+				return -1;
+			}
+			break;
+		case TYPE_INT:
+		case TYPE_BOOL:
+		case TYPE_DECIMAL:
+		case TYPE_DATE:
+		case TYPE_TIME:
+		case TYPE_INTERVAL:
+		case TYPE_FSBINARY:
+		case TYPE_DURATION:
+			c->type = ARROW_OTHER;
+			c->nbuf = 2U;
+			break;
+		default:
+			return -1;
+		}
+	}
+	return 0;
+}
+
+ssize_t
+arrow_rd_next(arrow_rd_t *rd)
+{
+	const arrow_buf_t *m = &rd->meta;
+	unsigned int type;
+	size_t hdr, nodes, bufs, nn = 0U, nb = 0U;
+	uint64_t len;
+	int rc;
+
+again:
+	if ((rc = rd_msg(rd, &type, &hdr)) <= 0) {
+		return rc;
+	} else if (type != MSG_BATCH) {
+		/* dictionary batches and friends are beyond us */
+		return -1;
+	} else if (fbr_fld(m, hdr, 3U, 4U) != NIL) {
+		/* compressed bodies too */
+		return -1;
+	}
+	len = fbr_scal(m, hdr, 0U, 8U, 0U);
+	nodes = fbr_vec(m, hdr, 1U, 16U, &nn);
+	bufs = fbr_vec(m, hdr, 2U, 16U, &nb);
+	if (UNLIKELY(len > SSIZE_MAX / 8U)) {
+		return -1;
+	} else if (UNLIKELY(nodes == NIL || nn != rd->ncol)) {
+		return -1;
+	} else if (UNLIKELY(bufs == NIL && rd->ncol)) {
+		return -1;
+	}
+	for (size_t i = 0U, k = 0U; i < rd->ncol; i++) {
+		arrow_rcol_t *c = rd->col + i;
+		const uint8_t *p[3U] = {NULL};
+		size_t n[3U] = {0U};
+
+		if (UNLIKELY(rd64(m->b + nodes + 16U * i) != len)) {
+			return -1;
+		} else if (UNLIKELY(k + c->nbuf > nb)) {
+			return -1;
+		}
+		for (size_t j = 0U; j < c->nbuf; j++, k++) {
+			const uint64_t o = rd64(m->b + bufs + 16U * k + 0U);
+			const uint64_t z = rd64(m->b + bufs + 16U * k + 8U);
+
+			if (UNLIKELY(o > rd->body.n || z > rd->body.n - o)) {
+				return -1;
+			}
+			p[j] = rd->body.b + o;
+			n[j] = z;
+		}
+		c->valid = rd64(m->b + nodes + 16U * i + 8U) ? p[0U] : NULL;
+		c->val = p[1U];
+		c->nval = n[1U];
+		c->dat = p[2U];
+		c->ndat = n[2U];
+		if (c->valid != NULL && UNLIKELY(n[0U] < (len + 7U) / 8U)) {
+			return -1;
+		}
+		switch (c->type) {
+		case ARROW_F64:
+		case ARROW_TS:
+			if (UNLIKELY(c->nval < 8U * len)) {
+				return -1;
+			}
+			break;
+		case ARROW_UTF8:
+			if (len && UNLIKELY(c->nval < 4U * (len + 1U))) {
+				return -1;
+			}
+			break;
+		case ARROW_LUTF8:
+			if (len && UNLIKELY(c->nval < 8U * (len + 1U))) {
+				return -1;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	if (!len) {
+		goto again;
+	}
+	return rd->nrow = len;
+}
+
+void
+arrow_rd_close(arrow_rd_t *rd)
+{
+	if (rd->col != NULL) {
+		for (size_t i = 0U; i < rd->ncol; i++) {
+			free(rd->col[i].name);
+		}
+		free(rd->col);
+	}
+	free(rd->meta.b);
+	free(rd->body.b);
+	*rd = (arrow_rd_t){.fp = NULL};
+	return;
+}
+
+int
+arrow_rd_find(const arrow_rd_t *rd, const char *name, arrow_type_t type)
+{
+	for (size_t i = 0U; i < rd->ncol; i++) {
+		if (rd->col[i].type == type && !strcmp(rd->col[i].name, name)) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+double
+arrow_f64(const arrow_rcol_t *c, size_t i)
+{
+	const uint64_t u = rd64(c->val + 8U * i);
+	double x;
+
+	memcpy(&x, &u, sizeof(x));
+	return x;
+}
+
+int64_t
+arrow_ts(const arrow_rcol_t *c, size_t i)
+{
+	static const int64_t div[] = {1, 1, 1000, 1000000};
+	const int64_t x = (int64_t)rd64(c->val + 8U * i);
+	const int64_t d = div[c->unit];
+
+	if (!c->unit) {
+		return x * 1000;
+	}
+	/* round towards -inf */
+	return (x - ((x % d) + d) % d) / d;
+}
+
+const char*
+arrow_utf8(const arrow_rcol_t *c, size_t i, size_t *len)
+{
+	int64_t o0, o1;
+
+	if (c->type == ARROW_LUTF8) {
+		o0 = (int64_t)rd64(c->val + 8U * i);
+		o1 = (int64_t)rd64(c->val + 8U * (i + 1U));
+	} else {
+		o0 = (int32_t)rd32(c->val + 4U * i);
+		o1 = (int32_t)rd32(c->val + 4U * (i + 1U));
+	}
+	if (UNLIKELY(o0 < 0 || o1 < o0 || (uint64_t)o1 > c->ndat)) {
+		return NULL;
+	}
+	*len = o1 - o0;
+	return (const char*)c->dat + o0;
+}
+
+/* arrow.c ends here */
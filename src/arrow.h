@@ -0,0 +1,162 @@
+/*** arrow.h -- Arrow IPC streams of flat columns
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_arrow_h_
+#define INCLUDED_arrow_h_
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * Column types, only flat columns are supported, columns of other flat
+ * types are read as ARROW_OTHER, nested ones are refused. */
+typedef enum {
+	ARROW_OTHER,
+	ARROW_UTF8,
+	ARROW_F64,
+	/* timestamps, written in milliseconds, UTC */
+	ARROW_TS,
+	/* large_string, 64-bit offsets, only read */
+	ARROW_LUTF8,
+} arrow_type_t;
+
+typedef struct {
+	uint8_t *b;
+	size_t n;
+	size_t z;
+} arrow_buf_t;
+
+/**
+ * Columns to write, NAME and TYPE are set by the caller, rows are
+ * appended with the arrow_push_*() functions. */
+typedef struct {
+	const char *name;
+	arrow_type_t type;
+	size_t nrow;
+	size_t nnul;
+	/* validity, values (or offsets) and data buffers */
+	arrow_buf_t buf[3U];
+} arrow_wcol_t;
+
+/**
+ * Columns read, valid between calls to arrow_rd_next(). */
+typedef struct {
+	char *name;
+	arrow_type_t type;
+	unsigned int nbuf;
+	/* time unit of timestamps, 0 for seconds through 3 for nanos */
+	unsigned int unit;
+	const uint8_t *valid;
+	const uint8_t *val;
+	size_t nval;
+	const uint8_t *dat;
+	size_t ndat;
+} arrow_rcol_t;
+
+typedef struct {
+	FILE *fp;
+	arrow_rcol_t *col;
+	size_t ncol;
+	size_t nrow;
+	arrow_buf_t meta;
+	arrow_buf_t body;
+} arrow_rd_t;
+
+
+/**
+ * Append a row to column C, a string S of length N, a double X,
+ * milliseconds since 1970-01-01 MS, or a null. */
+extern int arrow_push_utf8(arrow_wcol_t *c, const char *s, size_t n);
+extern int arrow_push_f64(arrow_wcol_t *c, double x);
+extern int arrow_push_ts(arrow_wcol_t *c, int64_t ms);
+extern int arrow_push_nul(arrow_wcol_t *c);
+
+/**
+ * Write the schema message for columns C (NC of them) through OUT. */
+extern int
+arrow_wr_schema(void(*out)(const char*, size_t),
+		const arrow_wcol_t *c, size_t nc);
+
+/**
+ * Write the rows of columns C (NC of them) through OUT as a record
+ * batch and empty the columns for the next one. */
+extern int
+arrow_wr_batch(void(*out)(const char*, size_t), arrow_wcol_t *c, size_t nc);
+
+/**
+ * Write the end-of-stream marker through OUT. */
+extern void arrow_wr_eos(void(*out)(const char*, size_t));
+
+/**
+ * Free resources of columns C. */
+extern void arrow_wcol_free(arrow_wcol_t *c, size_t nc);
+
+/**
+ * Read the schema of the stream FP into RD, RD must be closed with
+ * arrow_rd_close() even if this fails. */
+extern int arrow_rd_open(arrow_rd_t *rd, FILE *fp);
+
+/**
+ * Read the next record batch, return its number of rows, 0 at the end
+ * of the stream or -1 on error. */
+extern ssize_t arrow_rd_next(arrow_rd_t *rd);
+
+/**
+ * Free resources of RD. */
+extern void arrow_rd_close(arrow_rd_t *rd);
+
+/**
+ * Return the index of the column NAME of type TYPE in RD, or -1. */
+extern int
+arrow_rd_find(const arrow_rd_t *rd, const char *name, arrow_type_t type);
+
+/**
+ * Accessors for row I of column C of the current batch, arrow_utf8()
+ * serves ARROW_UTF8 and ARROW_LUTF8 and returns NULL for broken
+ * offsets. */
+extern double arrow_f64(const arrow_rcol_t *c, size_t i);
+extern int64_t arrow_ts(const arrow_rcol_t *c, size_t i);
+extern const char *arrow_utf8(const arrow_rcol_t *c, size_t i, size_t *len);
+
+static inline bool
+arrow_nul_p(const arrow_rcol_t *c, size_t i)
+{
+	return c->valid != NULL && !((c->valid[i / 8U] >> (i % 8U)) & 1U);
+}
+
+#endif	/* INCLUDED_arrow_h_ */
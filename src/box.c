@@ -0,0 +1,1088 @@
+/*** box.c -- mapping ranges onto geospatial boxes
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "box.h"
+#include "hilbert.h"
+#include "dt-strpf.h"
+#include "nifty.h"
+
+#define BOX_REFTM	{		\
+	.y = 2000,			\
+	.m = 1,				\
+	.d = 1,				\
+	.H = 0,				\
+	.M = 0,				\
+	.S = 0,				\
+	.ms = 0,			\
+}
+
+const echs_instant_t echs_box_reftm = BOX_REFTM;
+
+const echs_boxmap_t echs_box_defmap = {
+	.epoch = {BOX_REFTM, BOX_REFTM, BOX_REFTM},
+	.scale = {7, 7, 7},
+};
+
+/* the mapping in use and its factors */
+static echs_boxmap_t map = {
+	.epoch = {BOX_REFTM, BOX_REFTM, BOX_REFTM},
+	.scale = {7, 7, 7},
+};
+static double gpd[3U] = {0x1p-7, 0x1p-7, 0x1p-7};
+static double dpg[3U] = {0x1p7, 0x1p7, 0x1p7};
+/* milliseconds since 1970-01-01 of the epochs of the mapping */
+static int64_t unixoff[3U] = {
+	946684800000, 946684800000, 946684800000,
+};
+
+static const echs_instant_t unix_epoch = {
+	.y = 1970, .m = 1, .d = 1, .H = 0, .M = 0, .S = 0, .ms = 0,
+};
+
+static inline int64_t
+idiff_unixms(echs_idiff_t x)
+{
+	return echs_min_idiff_p(x)
+		? INT64_MIN
+		: echs_max_idiff_p(x)
+		? INT64_MAX
+		/* idiffs off negative coordinates may carry negative intras */
+		: (int64_t)x.dpart * MSECS_PER_DAY + (int32_t)x.intra;
+}
+
+static inline echs_idiff_t
+unixms_idiff(int64_t ms)
+{
+	int64_t q = ms / (int64_t)MSECS_PER_DAY;
+	int64_t r = ms % (int64_t)MSECS_PER_DAY;
+
+	if (ms == INT64_MIN) {
+		return echs_min_idiff();
+	} else if (ms == INT64_MAX) {
+		return echs_max_idiff();
+	} else if (r < 0) {
+		q--, r += MSECS_PER_DAY;
+	}
+	return (echs_idiff_t){(int32_t)q, (uint32_t)r};
+}
+
+static int64_t
+instant_unixms(echs_instant_t i)
+{
+/* milliseconds since 1970-01-01 at the start of I */
+	if (i.H == ECHS_ALL_DAY) {
+		i.H = 0, i.M = 0, i.S = 0, i.ms = 0;
+	} else if (i.ms == ECHS_ALL_SEC) {
+		i.ms = 0;
+	}
+	return idiff_unixms(echs_instant_diff(i, unix_epoch));
+}
+
+static inline int64_t
+unixms_off(int64_t ms, int64_t off)
+{
+	/* open ends stay open */
+	return ms == INT64_MIN || ms == INT64_MAX ? ms : ms + off;
+}
+
+
+
+/* Mappers specialised on the scales, the factors fold into constants.
+ * Scale pairs listed here map without loading anything, others go
+ * through the generic versions. */
+#define BOX_SPECIALS				\
+	BOX_SPECIAL(7, 7)			\
+	BOX_SPECIAL(10, 7)			\
+	BOX_SPECIAL(10, 4)
+
+#define BOX_SPECIAL(e0, e1)						\
+static echs_box_t							\
+idrng_box_##e0##_##e1(echs_idrng_t v, echs_idrng_t s)			\
+{									\
+	return (echs_box_t){						\
+		{idiff2geoflt(v.lower, ldexp(1, -(e0))),		\
+		 idiff2geoflt(s.lower, ldexp(1, -(e1)))},		\
+		{idiff2geoflt(v.upper, ldexp(1, -(e0))),		\
+		 idiff2geoflt(s.upper, ldexp(1, -(e1)))}};		\
+}									\
+									\
+static void								\
+box_idrng_##e0##_##e1(echs_idrng_t r[static 2U], echs_box_t b)		\
+{									\
+	r[0U].lower = geoflt2idiff(b.from[0U], ldexp(1, (e0)));	\
+	r[0U].upper = geoflt2idiff(b.to[0U], ldexp(1, (e0)));		\
+	r[1U].lower = geoflt2idiff(b.from[1U], ldexp(1, (e1)));	\
+	r[1U].upper = geoflt2idiff(b.to[1U], ldexp(1, (e1)));		\
+	return;								\
+}
+BOX_SPECIALS
+#undef BOX_SPECIAL
+
+static echs_box_t
+idrng_box_gen(echs_idrng_t v, echs_idrng_t s)
+{
+	return (echs_box_t){
+		{idiff2geoflt(v.lower, gpd[0U]), idiff2geoflt(s.lower, gpd[1U])},
+		{idiff2geoflt(v.upper, gpd[0U]), idiff2geoflt(s.upper, gpd[1U])}};
+}
+
+static void
+box_idrng_gen(echs_idrng_t r[static 2U], echs_box_t b)
+{
+	r[0U].lower = geoflt2idiff(b.from[0U], dpg[0U]);
+	r[0U].upper = geoflt2idiff(b.to[0U], dpg[0U]);
+	r[1U].lower = geoflt2idiff(b.from[1U], dpg[1U]);
+	r[1U].upper = geoflt2idiff(b.to[1U], dpg[1U]);
+	return;
+}
+
+/* warps, knots and their images in days off the epoch per dimension,
+ * for the log warp knot 0 is the pivot and wv[d][0U] the image of
+ * the epoch so that it stays put */
+static double wk[3U][MAX_BOXWARP_KNOTS];
+static double wv[3U][MAX_BOXWARP_KNOTS];
+
+static double
+warp(size_t d, double t)
+{
+	switch (map.warp.type) {
+	case BOXWARP_LOG: {
+		const double w = map.warp.slope[0U];
+		const double x = t - wk[d][0U];
+		return copysign(w * log1p(fabs(x) / w), x) - wv[d][0U];
+	}
+	case BOXWARP_PWL: {
+		size_t i;
+
+		for (i = map.warp.nknot - 1U; i && t < wk[d][i]; i--);
+		return wv[d][i] + map.warp.slope[i] * (t - wk[d][i]);
+	}
+	default:
+		break;
+	}
+	return t;
+}
+
+static double
+unwarp(size_t d, double g)
+{
+	switch (map.warp.type) {
+	case BOXWARP_LOG: {
+		const double w = map.warp.slope[0U];
+		const double x = g + wv[d][0U];
+		return wk[d][0U] + copysign(w * expm1(fabs(x) / w), x);
+	}
+	case BOXWARP_PWL: {
+		size_t i;
+
+		for (i = map.warp.nknot - 1U; i && g < wv[d][i]; i--);
+		return wk[d][i] + (g - wv[d][i]) / map.warp.slope[i];
+	}
+	default:
+		break;
+	}
+	return g;
+}
+
+static double
+idiff2warp(echs_idiff_t x, size_t d)
+{
+	double r;
+
+	if (UNLIKELY(echs_max_idiff_p(x))) {
+		return MAX_GEOFLT;
+	} else if (UNLIKELY(echs_min_idiff_p(x))) {
+		return MIN_GEOFLT;
+	}
+	r = (double)x.dpart + (double)x.intra / (double)MSECS_PER_DAY;
+	r = warp(d, r) * gpd[d];
+	return r >= MAX_GEOFLT
+		? MAX_GEOFLT
+		: r <= MIN_GEOFLT
+		? MIN_GEOFLT
+		: r;
+}
+
+static echs_idiff_t
+warp2idiff(double x, size_t d)
+{
+	double ms, dp;
+
+	if (x <= MIN_GEOFLT) {
+		return echs_min_idiff();
+	} else if (x >= MAX_GEOFLT) {
+		return echs_max_idiff();
+	}
+	/* round to the millisecond, the warp isn't exact in floating point */
+	ms = round(unwarp(d, x * dpg[d]) * (double)MSECS_PER_DAY);
+	dp = floor(ms / (double)MSECS_PER_DAY);
+	if (UNLIKELY(dp <= (double)INT32_MIN)) {
+		return echs_min_idiff();
+	} else if (UNLIKELY(dp >= (double)INT32_MAX)) {
+		return echs_max_idiff();
+	}
+	return (echs_idiff_t){
+		(int32_t)dp, (uint32_t)(ms - dp * (double)MSECS_PER_DAY)};
+}
+
+static echs_box_t
+idrng_box_warp(echs_idrng_t v, echs_idrng_t s)
+{
+	return (echs_box_t){
+		{idiff2warp(v.lower, 0U), idiff2warp(s.lower, 1U)},
+		{idiff2warp(v.upper, 0U), idiff2warp(s.upper, 1U)}};
+}
+
+static void
+box_idrng_warp(echs_idrng_t r[static 2U], echs_box_t b)
+{
+	r[0U].lower = warp2idiff(b.from[0U], 0U);
+	r[0U].upper = warp2idiff(b.to[0U], 0U);
+	r[1U].lower = warp2idiff(b.from[1U], 1U);
+	r[1U].upper = warp2idiff(b.to[1U], 1U);
+	return;
+}
+
+static echs_box_t(*idrng_box)(echs_idrng_t, echs_idrng_t) = idrng_box_7_7;
+static void(*box_idrng)(echs_idrng_t[static 2U], echs_box_t) = box_idrng_7_7;
+
+void
+echs_box_setmap(echs_boxmap_t m)
+{
+	map = m;
+	for (size_t d = 0U; d < 3U; d++) {
+		gpd[d] = ldexp(1, -m.scale[d]);
+		dpg[d] = ldexp(1, m.scale[d]);
+		unixoff[d] = instant_unixms(m.epoch[d]);
+	}
+	if (m.warp.type) {
+		for (size_t d = 0U; d < 3U; d++) {
+			for (size_t i = 0U; i < m.warp.nknot; i++) {
+				const echs_idiff_t k =
+					echs_instant_diff(m.warp.knot[i], m.epoch[d]);
+				wk[d][i] = (double)k.dpart +
+					(double)k.intra / (double)MSECS_PER_DAY;
+			}
+		}
+	}
+	switch (m.warp.type) {
+	case BOXWARP_LOG:
+		for (size_t d = 0U; d < 3U; d++) {
+			wv[d][0U] = 0;
+			wv[d][0U] = warp(d, 0);
+		}
+		idrng_box = idrng_box_warp;
+		box_idrng = box_idrng_warp;
+		return;
+	case BOXWARP_PWL:
+		for (size_t d = 0U; d < 3U; d++) {
+			double g0;
+
+			wv[d][0U] = 0;
+			for (size_t i = 1U; i < m.warp.nknot; i++) {
+				wv[d][i] = wv[d][i - 1U] + m.warp.slope[i - 1U] *
+					(wk[d][i] - wk[d][i - 1U]);
+			}
+			/* keep the epoch put */
+			g0 = warp(d, 0);
+			for (size_t i = 0U; i < m.warp.nknot; i++) {
+				wv[d][i] -= g0;
+			}
+		}
+		idrng_box = idrng_box_warp;
+		box_idrng = box_idrng_warp;
+		return;
+	default:
+		break;
+	}
+	idrng_box = idrng_box_gen;
+	box_idrng = box_idrng_gen;
+#define BOX_SPECIAL(e0, e1)						\
+	if (m.scale[0U] == (e0) && m.scale[1U] == (e1)) {		\
+		idrng_box = idrng_box_##e0##_##e1;			\
+		box_idrng = box_idrng_##e0##_##e1;			\
+	}
+	BOX_SPECIALS
+#undef BOX_SPECIAL
+	return;
+}
+
+echs_boxmap_t
+echs_box_getmap(void)
+{
+	return map;
+}
+
+static echs_instant_t
+boxmap_instant(const char *s, char **on)
+{
+/* epochs and knots are proper instants in the calendar's design range */
+	echs_instant_t i = dt_strp(s, on, strlen(s));
+
+	if (UNLIKELY(*on == NULL || echs_nul_instant_p(i))) {
+		*on = NULL;
+	} else if (UNLIKELY(i.y < 1901U || i.y > 2099U)) {
+		*on = NULL;
+	} else if (echs_instant_all_day_p(i)) {
+		i.H = i.M = i.S = i.ms = 0U;
+	} else if (echs_instant_all_sec_p(i)) {
+		i.ms = 0U;
+	}
+	return i;
+}
+
+static int
+boxwarp_strp(echs_boxwarp_t *restrict w, const char *s)
+{
+	static const char lg[] = "log,";
+	static const char pl[] = "pwl,";
+	char *on = NULL;
+
+	if (!strncmp(s, lg, strlenof(lg))) {
+		/* log,PIVOT[,WIDTH] */
+		w->type = BOXWARP_LOG;
+		w->nknot = 1U;
+		w->knot[0U] = boxmap_instant(s + strlenof(lg), &on);
+		w->slope[0U] = 365;
+		if (UNLIKELY(on == NULL)) {
+			return -1;
+		} else if (*on == ',') {
+			const char *ws = ++on;
+			const size_t z = strlen(ws);
+			echs_idiff_t d = idiff_strp(ws, &on, z);
+
+			/* idiff_strp() leaves ON past the terminator,
+			 * anywhere before it means trailing garbage */
+			if (UNLIKELY(on != ws + z + 1U)) {
+				return -1;
+			}
+			w->slope[0U] = (double)d.dpart +
+				(double)d.intra / (double)MSECS_PER_DAY;
+			if (UNLIKELY(!(w->slope[0U] > 0))) {
+				return -1;
+			}
+		} else if (*on) {
+			return -1;
+		}
+		return 0;
+	} else if (!strncmp(s, pl, strlenof(pl))) {
+		/* pwl,SLOPE@INSTANT[,SLOPE@INSTANT]... */
+		const char *p = s + strlenof(pl) - 1U;
+
+		w->type = BOXWARP_PWL;
+		w->nknot = 0U;
+		while (*p == ',') {
+			const char *ss = p + 1U;
+			double sl = strtod(ss, &on);
+
+			if (UNLIKELY(on == ss || *on++ != '@' || !(sl > 0))) {
+				return -1;
+			} else if (UNLIKELY(w->nknot >= MAX_BOXWARP_KNOTS)) {
+				return -1;
+			}
+			w->slope[w->nknot] = sl;
+			w->knot[w->nknot] = boxmap_instant(on, &on);
+			if (UNLIKELY(on == NULL)) {
+				return -1;
+			} else if (w->nknot &&
+				   UNLIKELY(!echs_instant_lt_p(
+						    w->knot[w->nknot - 1U],
+						    w->knot[w->nknot]))) {
+				/* knots must ascend */
+				return -1;
+			}
+			w->nknot++;
+			p = on;
+		}
+		return *p || !w->nknot ? -1 : 0;
+	} else if (!strcmp(s, "none")) {
+		w->type = BOXWARP_NONE;
+		w->nknot = 0U;
+		return 0;
+	}
+	return -1;
+}
+
+int
+echs_boxmap_strp(
+	echs_boxmap_t *restrict m,
+	const char *epoch, const char *scale, const char *warp)
+{
+	if (epoch != NULL) {
+		const char *s = epoch;
+
+		for (size_t d = 0U; d < 3U; d++) {
+			char *on = NULL;
+			echs_instant_t i = boxmap_instant(s, &on);
+
+			if (UNLIKELY(on == NULL)) {
+				return -1;
+			}
+			/* later dimensions default to the one before */
+			for (size_t j = d; j < 3U; j++) {
+				m->epoch[j] = i;
+			}
+			if (*on == ',' && d < 2U) {
+				s = on + 1U;
+			} else if (*on) {
+				return -1;
+			} else {
+				break;
+			}
+		}
+	}
+	if (scale != NULL) {
+		const char *s = scale;
+
+		for (size_t d = 0U; d < 3U; d++) {
+			char *on = NULL;
+			long int e = strtol(s, &on, 10);
+
+			if (UNLIKELY(on == s ||
+				     e < MIN_BOXMAP_SCALE || e > MAX_BOXMAP_SCALE)) {
+				return -1;
+			}
+			/* later dimensions default to the one before */
+			for (size_t j = d; j < 3U; j++) {
+				m->scale[j] = (int)e;
+			}
+			if (*on == ',' && d < 2U) {
+				s = on + 1U;
+			} else if (*on) {
+				return -1;
+			} else {
+				break;
+			}
+		}
+	}
+	if (warp != NULL && UNLIKELY(boxwarp_strp(&m->warp, warp) < 0)) {
+		return -1;
+	}
+	return 0;
+}
+
+
+
+echs_box_t
+echs_idrng_box(echs_idrng_t v, echs_idrng_t s)
+{
+	return idrng_box(v, s);
+}
+
+echs_box_t
+echs_range_box(echs_range_t valid, echs_range_t systm)
+{
+	return echs_idrng_box(
+		echs_range_diff(valid, map.epoch[0U]),
+		echs_range_diff(systm, map.epoch[1U]));
+}
+
+void
+echs_box_range(echs_range_t rng[static 2U], echs_box_t b)
+{
+	echs_idrng_t r[2U];
+
+	box_idrng(r, b);
+	echs_idrng_range(rng, r);
+	return;
+}
+
+void
+echs_idrng_range(echs_range_t rng[static 2U], const echs_idrng_t r[static 2U])
+{
+	echs_idrng_t v;
+
+	v = r[0U];
+	v.upper.dpart -=
+		!echs_max_idiff_p(v.upper) && !v.lower.intra && !v.upper.intra;
+	rng[0U] = echs_range_add(v, map.epoch[0U]);
+	rng[0U].beg.H += ECHS_ALL_DAY +
+		(echs_min_idiff_p(v.lower) || v.lower.intra || v.upper.intra);
+	rng[0U].end.H += ECHS_ALL_DAY +
+		(echs_max_idiff_p(v.upper) || v.lower.intra || v.upper.intra);
+	rng[1U] = echs_range_add(r[1U], map.epoch[1U]);
+	return;
+}
+
+void
+echs_box_unixms(int64_t ms[static 4U], echs_box_t b)
+{
+	echs_idrng_t r[2U];
+
+	box_idrng(r, b);
+	for (size_t d = 0U; d < 2U; d++) {
+		const int64_t lo = idiff_unixms(r[d].lower);
+		const int64_t hi = idiff_unixms(r[d].upper);
+
+		ms[2U * d + 0U] = unixms_off(lo, unixoff[d]);
+		ms[2U * d + 1U] = unixms_off(hi, unixoff[d]);
+	}
+	return;
+}
+
+echs_box_t
+echs_unixms_box(const int64_t ms[static 4U])
+{
+	return idrng_box(
+		echs_unixms_idrng(ms + 0U, 0U), echs_unixms_idrng(ms + 2U, 1U));
+}
+
+void
+echs_idrng_unixms(int64_t ms[static 2U], echs_idrng_t r, unsigned int d)
+{
+	ms[0U] = unixms_off(idiff_unixms(r.lower), unixoff[d]);
+	ms[1U] = unixms_off(idiff_unixms(r.upper), unixoff[d]);
+	return;
+}
+
+echs_idrng_t
+echs_unixms_idrng(const int64_t ms[static 2U], unsigned int d)
+{
+	return (echs_idrng_t){
+		unixms_idiff(unixms_off(ms[0U], -unixoff[d])),
+		unixms_idiff(unixms_off(ms[1U], -unixoff[d])),
+	};
+}
+
+void
+echs_range_z(double z[static 2U], echs_range_t decis)
+{
+	echs_idrng_z(z, echs_range_diff(decis, map.epoch[2U]));
+	return;
+}
+
+void
+echs_idrng_z(double z[static 2U], echs_idrng_t r)
+{
+	if (map.warp.type) {
+		z[0U] = idiff2warp(r.lower, 2U);
+		z[1U] = idiff2warp(r.upper, 2U);
+	} else {
+		z[0U] = idiff2geoflt(r.lower, gpd[2U]);
+		z[1U] = idiff2geoflt(r.upper, gpd[2U]);
+	}
+	return;
+}
+
+static echs_idrng_t
+z_idrng(const double z[static 2U])
+{
+	echs_idrng_t r;
+
+	if (map.warp.type) {
+		r.lower = warp2idiff(z[0U], 2U);
+		r.upper = warp2idiff(z[1U], 2U);
+	} else {
+		r.lower = geoflt2idiff(z[0U], dpg[2U]);
+		r.upper = geoflt2idiff(z[1U], dpg[2U]);
+	}
+	return r;
+}
+
+echs_range_t
+echs_z_range(const double z[static 2U])
+{
+	return echs_range_add(z_idrng(z), map.epoch[2U]);
+}
+
+void
+echs_z_unixms(int64_t ms[static 2U], const double z[static 2U])
+{
+	const echs_idrng_t r = z_idrng(z);
+
+	ms[0U] = unixms_off(idiff_unixms(r.lower), unixoff[2U]);
+	ms[1U] = unixms_off(idiff_unixms(r.upper), unixoff[2U]);
+	return;
+}
+
+static inline echs_idiff_t
+idiff_succ(echs_idiff_t x)
+{
+	if (++x.intra >= MSECS_PER_DAY) {
+		x.dpart++;
+		x.intra = 0U;
+	}
+	return x;
+}
+
+static inline echs_idiff_t
+idiff_pred(echs_idiff_t x)
+{
+	if (!x.intra--) {
+		x.dpart--;
+		x.intra = MSECS_PER_DAY - 1U;
+	}
+	return x;
+}
+
+echs_box_t
+echs_range_qbox(echs_range_t valid, echs_range_t systm)
+{
+	const echs_idrng_t v = echs_range_diff(valid, map.epoch[0U]);
+	const echs_idrng_t s = echs_range_diff(systm, map.epoch[1U]);
+	/* boxes of the first and the last millisecond of the ranges,
+	 * their centres are off the millisecond grid that box edges
+	 * are on, so closed intersection becomes half-open overlap */
+	const echs_box_t lo = idrng_box(
+		(echs_idrng_t){v.lower, idiff_succ(v.lower)},
+		(echs_idrng_t){s.lower, idiff_succ(s.lower)});
+	const echs_box_t hi = idrng_box(
+		(echs_idrng_t){idiff_pred(v.upper), v.upper},
+		(echs_idrng_t){idiff_pred(s.upper), s.upper});
+	const echs_idrng_t r[2U] = {v, s};
+	echs_box_t q;
+
+	for (size_t d = 0U; d < 2U; d++) {
+		q.from[d] = echs_min_idiff_p(r[d].lower)
+			? MIN_GEOFLT : (lo.from[d] + lo.to[d]) / 2;
+		q.to[d] = echs_max_idiff_p(r[d].upper)
+			? MAX_GEOFLT : (hi.from[d] + hi.to[d]) / 2;
+	}
+	return q;
+}
+
+bool
+echs_range_qbox_exact_p(echs_box_t q, echs_range_t valid, echs_range_t systm)
+{
+	const echs_range_t r[2U] = {valid, systm};
+
+	for (size_t d = 0U; d < 2U; d++) {
+		if (!echs_min_instant_p(r[d].beg) &&
+		    (q.from[d] <= MIN_GEOFLT || q.from[d] >= MAX_GEOFLT)) {
+			return false;
+		} else if (!echs_max_instant_p(r[d].end) &&
+			   (q.to[d] <= MIN_GEOFLT || q.to[d] >= MAX_GEOFLT)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline bool
+box_abut_p(echs_box_t a, echs_box_t b, size_t d)
+{
+	const size_t o = d ^ 1U;
+
+	return a.from[o] == b.from[o] && a.to[o] == b.to[o] &&
+		(a.to[d] == b.from[d] || b.to[d] == a.from[d]);
+}
+
+size_t
+echs_box_merge(echs_box_t *b, double *z, size_t *rec, size_t n)
+{
+	bool chgp;
+
+	do {
+		chgp = false;
+		for (size_t i = 0U; i < n; i++) {
+			for (size_t j = i + 1U; j < n;) {
+				if (!box_abut_p(b[i], b[j], 0U) &&
+				    !box_abut_p(b[i], b[j], 1U)) {
+					j++;
+					continue;
+				} else if (z != NULL &&
+					   (z[2U * i + 0U] != z[2U * j + 0U] ||
+					    z[2U * i + 1U] != z[2U * j + 1U])) {
+					j++;
+					continue;
+				} else if (rec != NULL && rec[i] != rec[j]) {
+					/* abutting records stay apart */
+					j++;
+					continue;
+				}
+				b[i] = echs_box_union(b[i], b[j]);
+				memmove(b + j, b + j + 1U,
+					(n - j - 1U) * sizeof(*b));
+				if (z != NULL) {
+					memmove(z + 2U * j, z + 2U * (j + 1U),
+						2U * (n - j - 1U) * sizeof(*z));
+				}
+				if (rec != NULL) {
+					memmove(rec + j, rec + j + 1U,
+						(n - j - 1U) * sizeof(*rec));
+				}
+				n--;
+				chgp = true;
+			}
+		}
+	} while (chgp);
+	return n;
+}
+
+static inline double
+box_area(echs_box_t b)
+{
+	return (b.to[0U] - b.from[0U]) * (b.to[1U] - b.from[1U]);
+}
+
+static inline double
+box_waste(echs_box_t a, echs_box_t b)
+{
+/* area that the union of A and B covers in excess of A and B */
+	const double ix =
+		fmin(a.to[0U], b.to[0U]) - fmax(a.from[0U], b.from[0U]);
+	const double iy =
+		fmin(a.to[1U], b.to[1U]) - fmax(a.from[1U], b.from[1U]);
+	const double i = ix > 0 && iy > 0 ? ix * iy : 0;
+
+	return box_area(echs_box_union(a, b)) - box_area(a) - box_area(b) + i;
+}
+
+/* candidate merges, I's version VI and J's version VJ at push time */
+struct agg_s {
+	double c;
+	uint32_t i, j;
+	uint32_t vi, vj;
+};
+
+#define AGG_DEAD	((uint32_t)-1)
+
+static inline bool
+agg_lt(struct agg_s a, struct agg_s b)
+{
+	return a.c < b.c ||
+		(a.c == b.c && (a.i < b.i || (a.i == b.i && a.j < b.j)));
+}
+
+static void
+agg_push(struct agg_s *restrict hp, size_t *nhp, struct agg_s a)
+{
+	size_t k = (*nhp)++;
+
+	for (; k && agg_lt(a, hp[(k - 1U) / 2U]); k = (k - 1U) / 2U) {
+		hp[k] = hp[(k - 1U) / 2U];
+	}
+	hp[k] = a;
+	return;
+}
+
+static struct agg_s
+agg_pop(struct agg_s *restrict hp, size_t *nhp)
+{
+	const struct agg_s top = hp[0U];
+	const struct agg_s a = hp[--*nhp];
+	size_t k = 0U;
+
+	for (size_t m; (m = 2U * k + 1U) < *nhp; k = m) {
+		if (m + 1U < *nhp && agg_lt(hp[m + 1U], hp[m])) {
+			m++;
+		}
+		if (!agg_lt(hp[m], a)) {
+			break;
+		}
+		hp[k] = hp[m];
+	}
+	hp[k] = a;
+	return top;
+}
+
+static void
+agg_near(
+	struct agg_s *restrict hp, size_t *nhp,
+	const echs_box_t *b, const uint32_t *ver, size_t n, size_t i)
+{
+/* push I's cheapest partner */
+	struct agg_s a = {.c = INFINITY, .i = i, .j = AGG_DEAD};
+
+	for (size_t j = 0U; j < n; j++) {
+		double c;
+
+		if (j == i || ver[j] == AGG_DEAD) {
+			continue;
+		} else if ((c = box_waste(b[i], b[j])) < a.c ||
+			   a.j == AGG_DEAD) {
+			a.c = c;
+			a.j = j;
+		}
+	}
+	if (a.j != AGG_DEAD) {
+		a.vi = ver[i];
+		a.vj = ver[a.j];
+		agg_push(hp, nhp, a);
+	}
+	return;
+}
+
+size_t
+echs_box_simplify(echs_box_t *restrict b, size_t n, size_t k)
+{
+	struct agg_s *hp;
+	uint32_t *ver;
+	size_t nhp = 0U;
+	size_t m = n;
+
+	if (n <= k) {
+		return n;
+	} else if (UNLIKELY(!k)) {
+		k = 1U;
+	}
+	/* each pop pushes at most one candidate, so N slots will do */
+	hp = malloc(n * sizeof(*hp));
+	ver = calloc(n, sizeof(*ver));
+	if (UNLIKELY(hp == NULL || ver == NULL)) {
+		/* fall back to the envelope, it's a covering after all */
+		for (size_t i = 1U; i < n; i++) {
+			b[0U] = echs_box_union(b[0U], b[i]);
+		}
+		m = 1U;
+		goto out;
+	}
+	for (size_t i = 0U; i < n; i++) {
+		agg_near(hp, &nhp, b, ver, n, i);
+	}
+	while (m > k && nhp) {
+		const struct agg_s a = agg_pop(hp, &nhp);
+
+		if (ver[a.i] != a.vi) {
+			/* I has moved on, there's a fresher candidate */
+			continue;
+		} else if (ver[a.j] != a.vj) {
+			/* partner's gone or grown, look again */
+			agg_near(hp, &nhp, b, ver, n, a.i);
+			continue;
+		}
+		b[a.i] = echs_box_union(b[a.i], b[a.j]);
+		ver[a.j] = AGG_DEAD;
+		ver[a.i]++;
+		m--;
+		agg_near(hp, &nhp, b, ver, n, a.i);
+	}
+	/* compact */
+	for (size_t i = 0U, j = 0U; i < n; i++) {
+		if (ver[i] != AGG_DEAD) {
+			b[j++] = b[i];
+		}
+	}
+out:
+	free(hp);
+	free(ver);
+	return m;
+}
+
+uint64_t
+echs_box_hilbert(echs_box_t b)
+{
+/* centres live in [-90, 90] x [-90, 90], stretch that onto 32 bits */
+	const double sc = (double)UINT32_MAX / 180;
+	const double x = (b.from[0U] + b.to[0U]) / 2 + 90;
+	const double y = (b.from[1U] + b.to[1U]) / 2 + 90;
+	const double cx = x <= 0 ? 0 : x >= 180 ? 180 : x;
+	const double cy = y <= 0 ? 0 : y >= 180 ? 180 : y;
+
+	return echs_hilbert((uint32_t)(cx * sc), (uint32_t)(cy * sc));
+}
+
+void
+echs_box_cells(
+	uint32_t lo[static 2U], uint32_t hi[static 2U],
+	echs_box_t b, unsigned int bits)
+{
+/* boxes are half-open, a box ending on a cell border stops short of
+ * the next cell, empty boxes still get the cell they sit in */
+	const double ncell = ldexp(1, bits);
+	const double maxc = ncell - 1;
+
+	for (size_t i = 0U; i < 2U; i++) {
+		double l = floor((b.from[i] + 90) / 180 * ncell);
+		double h = ceil((b.to[i] + 90) / 180 * ncell) - 1;
+
+		l = l < 0 ? 0 : l > maxc ? maxc : l;
+		h = h < l ? l : h > maxc ? maxc : h;
+		lo[i] = (uint32_t)l;
+		hi[i] = (uint32_t)h;
+	}
+	return;
+}
+
+
+echs_box_t
+box_strp(const char *str, char **on, size_t len)
+{
+	static const char box[] = "BOX";
+	const char *sp = str;
+	const char *const ep = str + len;
+	echs_box_t b;
+
+	if (UNLIKELY(len <= strlenof(box) || memcmp(sp, box, strlenof(box)))) {
+		goto err;
+	}
+	/* optionally allow 2D */
+	if (*(sp += strlenof(box)) == '2') {
+		if (UNLIKELY(++sp >= ep || *sp++ != 'D')) {
+			goto err;
+		}
+	}
+	if (UNLIKELY(sp >= ep || *sp++ != '(')) {
+		goto err;
+	}
+	for (size_t i = 0U; i < 4U; i++) {
+		double *const tgt = i < 2U ? b.from + i : b.to + (i - 2U);
+		char *eo = NULL;
+
+		/* read over whitespace */
+		for (; sp < ep && isspace(*sp); sp++);
+		if (i == 2U) {
+			if (UNLIKELY(sp >= ep || *sp++ != ',')) {
+				/* what sort of 2d data is this? */
+				goto err;
+			}
+			for (; sp < ep && isspace(*sp); sp++);
+		}
+		*tgt = strtod(sp, &eo);
+		if (UNLIKELY(eo == NULL || eo == sp || eo > ep)) {
+			goto err;
+		}
+		sp = eo;
+	}
+	for (; sp < ep && isspace(*sp); sp++);
+	if (UNLIKELY(sp >= ep || *sp++ != ')')) {
+		goto err;
+	}
+	if (on != NULL) {
+		*on = deconst(sp);
+	}
+	return b;
+err:
+	if (on != NULL) {
+		*on = NULL;
+	}
+	return (echs_box_t){{NAN, NAN}, {NAN, NAN}};
+}
+
+size_t
+box_strf(char *restrict buf, size_t bsz, echs_box_t b)
+{
+	int z = snprintf(buf, bsz, "BOX(%.17f %.17f, %.17f %.17f)",
+			 b.from[0U], b.from[1U], b.to[0U], b.to[1U]);
+
+	if (UNLIKELY(z < 0)) {
+		return 0U;
+	}
+	return (size_t)z < bsz ? (size_t)z : bsz - 1U;
+}
+
+echs_box_t
+box3_strp(double z[static 2U], const char *str, char **on, size_t len)
+{
+	static const char box[] = "BOX3D";
+	const char *sp = str;
+	const char *const ep = str + len;
+	echs_box_t b;
+
+	if (UNLIKELY(len <= strlenof(box) || memcmp(sp, box, strlenof(box)))) {
+		goto err;
+	}
+	sp += strlenof(box);
+	if (UNLIKELY(sp >= ep || *sp++ != '(')) {
+		goto err;
+	}
+	for (size_t i = 0U; i < 6U; i++) {
+		double *const tgt = i == 2U ? z : i == 5U ? z + 1U
+			: i < 2U ? b.from + i : b.to + (i - 3U);
+		char *eo = NULL;
+
+		/* read over whitespace */
+		for (; sp < ep && isspace(*sp); sp++);
+		if (i == 3U) {
+			if (UNLIKELY(sp >= ep || *sp++ != ',')) {
+				goto err;
+			}
+			for (; sp < ep && isspace(*sp); sp++);
+		}
+		*tgt = strtod(sp, &eo);
+		if (UNLIKELY(eo == NULL || eo == sp || eo > ep)) {
+			goto err;
+		}
+		sp = eo;
+	}
+	for (; sp < ep && isspace(*sp); sp++);
+	if (UNLIKELY(sp >= ep || *sp++ != ')')) {
+		goto err;
+	}
+	if (on != NULL) {
+		*on = deconst(sp);
+	}
+	return b;
+err:
+	if (on != NULL) {
+		*on = NULL;
+	}
+	z[0U] = z[1U] = NAN;
+	return (echs_box_t){{NAN, NAN}, {NAN, NAN}};
+}
+
+size_t
+box3_strf(char *restrict buf, size_t bsz, echs_box_t b, const double z[static 2U])
+{
+	int r = snprintf(buf, bsz, "BOX3D(%.17f %.17f %.17f, %.17f %.17f %.17f)",
+			 b.from[0U], b.from[1U], z[0U],
+			 b.to[0U], b.to[1U], z[1U]);
+
+	if (UNLIKELY(r < 0)) {
+		return 0U;
+	}
+	return (size_t)r < bsz ? (size_t)r : bsz - 1U;
+}
+
+size_t
+qbox_strf(char *restrict buf, size_t bsz, echs_box_t b)
+{
+	int r;
+
+	if (b.from[0U] == b.to[0U] && b.from[1U] == b.to[1U]) {
+		r = snprintf(buf, bsz, "POINT(%.17f %.17f)",
+			     b.from[0U], b.from[1U]);
+	} else if (b.from[0U] == b.to[0U] || b.from[1U] == b.to[1U]) {
+		r = snprintf(buf, bsz, "LINESTRING(%.17f %.17f, %.17f %.17f)",
+			     b.from[0U], b.from[1U], b.to[0U], b.to[1U]);
+	} else {
+		return box_strf(buf, bsz, b);
+	}
+	if (UNLIKELY(r < 0)) {
+		return 0U;
+	}
+	return (size_t)r < bsz ? (size_t)r : bsz - 1U;
+}
+
+/* box.c ends here */
@@ -0,0 +1,313 @@
+/*** box.h -- mapping ranges onto geospatial boxes
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_box_h_
+#define INCLUDED_box_h_
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include "instant.h"
+#include "range.h"
+
+/**
+ * Bitemporal boxes, dimension 0 is validity, dimension 1 system time. */
+typedef struct {
+	double from[2U];
+	double to[2U];
+} echs_box_t;
+
+#define MAX_GEOFLT	((double)90)
+#define MIN_GEOFLT	(-MAX_GEOFLT)
+
+/**
+ * Optional monotone warps of time applied before scaling, in days off
+ * the epoch.  The log warp maps t to sgn(t - p) * w * log(1 + |t - p| / w)
+ * for pivot p (KNOT[0U]) and width w (SLOPE[0U], in days), the pwl warp
+ * stretches time by SLOPE[i] from KNOT[i] on, before KNOT[0U] by SLOPE[0U].
+ * Either way the epoch itself maps to 0. */
+#define MAX_BOXWARP_KNOTS	(16U)
+
+typedef struct {
+	enum {
+		BOXWARP_NONE,
+		BOXWARP_LOG,
+		BOXWARP_PWL,
+	} type;
+	size_t nknot;
+	echs_instant_t knot[MAX_BOXWARP_KNOTS];
+	double slope[MAX_BOXWARP_KNOTS];
+} echs_boxwarp_t;
+
+/**
+ * Mapping of time onto coordinates, the third dimension (z) is for
+ * tri-temporal data (issue or decision time), per dimension an epoch and a binary
+ * scale, coordinates are (warped) days since the epoch divided by 2^scale
+ * and clamped to [MIN_GEOFLT, MAX_GEOFLT]. */
+typedef struct {
+	echs_instant_t epoch[3U];
+	int scale[3U];
+	echs_boxwarp_t warp;
+} echs_boxmap_t;
+
+#define MIN_BOXMAP_SCALE	(-16)
+#define MAX_BOXMAP_SCALE	(24)
+
+/**
+ * Reference instant of the default mapping, 2000-01-01T00:00:00.000Z. */
+extern const echs_instant_t echs_box_reftm;
+
+/**
+ * The default mapping, `echs_box_reftm' and 2^7 days per degree in
+ * both dimensions. */
+extern const echs_boxmap_t echs_box_defmap;
+
+
+/**
+ * Use mapping M in all subsequent conversions. */
+extern void echs_box_setmap(echs_boxmap_t m);
+
+/**
+ * Return the mapping currently in use. */
+extern echs_boxmap_t echs_box_getmap(void);
+
+/**
+ * Parse EPOCH and SCALE, both of the form VALID[,SYSTEM[,DECISION]],
+ * and WARP, one of none, log,PIVOT[,WIDTH] or
+ * pwl,SLOPE@INSTANT[,SLOPE@INSTANT]... into M.  Any may be NULL to keep
+ * what's in M, omitted dimensions take the value of the one before.
+ * Return -1 if one of them doesn't parse. */
+extern int
+echs_boxmap_strp(
+	echs_boxmap_t *restrict m,
+	const char *epoch, const char *scale, const char *warp);
+
+/**
+ * Return the box spanned by the valid idiff range V and system range S,
+ * both relative to the epochs of the current mapping. */
+extern echs_box_t echs_idrng_box(echs_idrng_t v, echs_idrng_t s);
+
+/**
+ * Return the box spanned by ranges VALID and SYSTM. */
+extern echs_box_t echs_range_box(echs_range_t valid, echs_range_t systm);
+
+/**
+ * Map box B back onto time, the valid range is put into RNG[0U],
+ * the system range into RNG[1U]. */
+extern void echs_box_range(echs_range_t rng[static 2U], echs_box_t b);
+
+/**
+ * Like echs_box_range() but for ranges R relative to the epochs,
+ * valid in R[0U], system in R[1U], without going through a box. */
+extern void
+echs_idrng_range(echs_range_t rng[static 2U], const echs_idrng_t r[static 2U]);
+
+/**
+ * Map box B onto milliseconds since 1970-01-01T00:00:00.000Z, the
+ * valid range into MS[0U] and MS[1U], the system range into MS[2U]
+ * and MS[3U], all half-open, open ends become INT64_MIN or INT64_MAX. */
+extern void echs_box_unixms(int64_t ms[static 4U], echs_box_t b);
+
+/**
+ * The inverse of echs_box_unixms(). */
+extern echs_box_t echs_unixms_box(const int64_t ms[static 4U]);
+
+/**
+ * Put range R, relative to the epoch of dimension D, into MS[0U] and
+ * MS[1U] as milliseconds since 1970-01-01, exactly, open ends become
+ * INT64_MIN or INT64_MAX. */
+extern void
+echs_idrng_unixms(int64_t ms[static 2U], echs_idrng_t r, unsigned int d);
+
+/**
+ * Return the range MS[0U] to MS[1U] in milliseconds since 1970-01-01,
+ * INT64_MIN and INT64_MAX being open ends, relative to the epoch of
+ * dimension D, for echs_idrng_box() or echs_idrng_z(). */
+extern echs_idrng_t
+echs_unixms_idrng(const int64_t ms[static 2U], unsigned int d);
+
+/**
+ * Return the query window for facts whose valid range overlaps VALID
+ * and whose system range overlaps SYSTM.  The window's edges sit half
+ * a millisecond inside the ranges, so that a closed intersection test
+ * (sfIntersects) against fact boxes is exact.  Windows that are thin
+ * in a dimension have FROM equal TO there. */
+extern echs_box_t echs_range_qbox(echs_range_t valid, echs_range_t systm);
+
+/**
+ * Return true iff the query window Q of VALID and SYSTM, see
+ * `echs_range_qbox()', is exact, i.e. none of the finite ends of the
+ * ranges got clamped to the edge of the mapping, where the window
+ * would also meet facts lying entirely beyond the edge. */
+extern bool
+echs_range_qbox_exact_p(echs_box_t q, echs_range_t valid, echs_range_t systm);
+
+/**
+ * Map the decision range DECIS onto z coordinates Z[0U] and Z[1U]. */
+extern void echs_range_z(double z[static 2U], echs_range_t decis);
+
+/**
+ * Like echs_range_z() for R relative to the decision epoch. */
+extern void echs_idrng_z(double z[static 2U], echs_idrng_t r);
+
+/**
+ * Map z coordinates Z back onto a decision range. */
+extern echs_range_t echs_z_range(const double z[static 2U]);
+
+/**
+ * Map z coordinates Z onto milliseconds since 1970-01-01, see
+ * echs_box_unixms(). */
+extern void echs_z_unixms(int64_t ms[static 2U], const double z[static 2U]);
+
+/**
+ * Merge boxes in B (of size N) that abut along one dimension and agree
+ * on the other, return the new number of boxes.  If non-NULL, Z holds
+ * N pairs of z coordinates which must agree too and are kept in step,
+ * likewise REC holds N record numbers, only pieces of the same record
+ * are merged. */
+extern size_t
+echs_box_merge(echs_box_t *b, double *z, size_t *rec, size_t n);
+
+/**
+ * Replace the N boxes in B by at most K boxes covering them, greedily
+ * merging the pair that adds the least false-positive area first,
+ * return the new number of boxes. */
+extern size_t echs_box_simplify(echs_box_t *restrict b, size_t n, size_t k);
+
+/**
+ * Return the Hilbert index of the centre of box B. */
+extern uint64_t echs_box_hilbert(echs_box_t b);
+
+/**
+ * Put the cells of the 2^BITS x 2^BITS grid over [-90, 90]^2 that
+ * box B intersects into LO[0U]..HI[0U] x LO[1U]..HI[1U]. */
+extern void
+echs_box_cells(
+	uint32_t lo[static 2U], uint32_t hi[static 2U],
+	echs_box_t b, unsigned int bits);
+
+/**
+ * Parse a WKT BOX or BOX2D from STR, set ON to the end of the parse
+ * or to NULL if STR does not start with a box. */
+extern echs_box_t box_strp(const char *str, char **on, size_t len);
+
+/**
+ * Print box B as WKT into BUF (of size BSZ) and return its length. */
+extern size_t box_strf(char *restrict buf, size_t bsz, echs_box_t b);
+
+/**
+ * Parse a WKT BOX3D from STR, put the z coordinates into Z, set ON to
+ * the end of the parse or to NULL if STR does not start with a box. */
+extern echs_box_t
+box3_strp(double z[static 2U], const char *str, char **on, size_t len);
+
+/**
+ * Print box B with z coordinates Z as WKT BOX3D into BUF (of size BSZ)
+ * and return its length. */
+extern size_t
+box3_strf(char *restrict buf, size_t bsz, echs_box_t b, const double z[static 2U]);
+
+/**
+ * Print query window B as WKT into BUF (of size BSZ), as POINT when thin
+ * in both dimensions, as LINESTRING when thin in one, as BOX otherwise. */
+extern size_t qbox_strf(char *restrict buf, size_t bsz, echs_box_t b);
+
+
+/* time and geo magic, F is the number of coordinate units per day */
+static inline __attribute__((const, pure)) double
+idiff2geoflt(echs_idiff_t x, double f)
+{
+	double r = ((double)x.dpart + (double)x.intra / (double)MSECS_PER_DAY) * f;
+	return r >= MAX_GEOFLT
+		? MAX_GEOFLT
+		: r <= MIN_GEOFLT
+		? MIN_GEOFLT
+		: r;
+}
+
+/* and back, F is the number of days per coordinate unit */
+static inline __attribute__((const, pure)) echs_idiff_t
+geoflt2idiff(double x, double f)
+{
+	double d = x * f;
+	double ipart = trunc(d);
+	return x <= MIN_GEOFLT
+		? echs_min_idiff()
+		: x >= MAX_GEOFLT
+		? echs_max_idiff()
+		: (echs_idiff_t){
+		(int32_t)ipart,
+			(uint32_t)((d - ipart) * (double)MSECS_PER_DAY)};
+}
+
+/**
+ * Return true iff boxes A and B intersect, borders excluded. */
+static inline __attribute__((const, pure)) bool
+echs_box_intersects_p(echs_box_t a, echs_box_t b)
+{
+	return a.from[0U] < b.to[0U] && b.from[0U] < a.to[0U] &&
+		a.from[1U] < b.to[1U] && b.from[1U] < a.to[1U];
+}
+
+/**
+ * Return true iff box A contains B, borders included. */
+static inline __attribute__((const, pure)) bool
+echs_box_contains_p(echs_box_t a, echs_box_t b)
+{
+	return a.from[0U] <= b.from[0U] && b.to[0U] <= a.to[0U] &&
+		a.from[1U] <= b.from[1U] && b.to[1U] <= a.to[1U];
+}
+
+/**
+ * Return true iff boxes A and B intersect, borders included. */
+static inline __attribute__((const, pure)) bool
+echs_box_touches_p(echs_box_t a, echs_box_t b)
+{
+	return a.from[0U] <= b.to[0U] && b.from[0U] <= a.to[0U] &&
+		a.from[1U] <= b.to[1U] && b.from[1U] <= a.to[1U];
+}
+
+/**
+ * Return the smallest box containing A and B. */
+static inline __attribute__((const, pure)) echs_box_t
+echs_box_union(echs_box_t a, echs_box_t b)
+{
+	return (echs_box_t){
+		{fmin(a.from[0U], b.from[0U]), fmin(a.from[1U], b.from[1U])},
+		{fmax(a.to[0U], b.to[0U]), fmax(a.to[1U], b.to[1U])}};
+}
+
+#endif	/* INCLUDED_box_h_ */
@@ -0,0 +1,128 @@
+/*** boxarrow.c -- boxes as rows of Arrow IPC streams
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdint.h>
+#include <string.h>
+#include "boxarrow.h"
+#include "nifty.h"
+
+static arrow_wcol_t bcol[] = {
+	{.name = "key", .type = ARROW_UTF8},
+	{.name = "valid_from", .type = ARROW_TS},
+	{.name = "valid_till", .type = ARROW_TS},
+	{.name = "system_from", .type = ARROW_TS},
+	{.name = "system_till", .type = ARROW_TS},
+	{.name = "xmin", .type = ARROW_F64},
+	{.name = "ymin", .type = ARROW_F64},
+	{.name = "xmax", .type = ARROW_F64},
+	{.name = "ymax", .type = ARROW_F64},
+};
+
+
+int
+boxarrow_beg(void(*out)(const char*, size_t))
+{
+	return arrow_wr_schema(out, bcol, countof(bcol));
+}
+
+int
+boxarrow_push(void(*out)(const char*, size_t), size_t batchz,
+	      const char *key, size_t nkey,
+	      echs_box_t b, const int64_t ms[static 4U])
+{
+	int rc = 0;
+
+	rc |= key != NULL
+		? arrow_push_utf8(bcol + 0U, key, nkey)
+		: arrow_push_nul(bcol + 0U);
+	for (size_t j = 0U; j < 4U; j++) {
+		/* open ends are nulls */
+		rc |= ms[j] > INT64_MIN && ms[j] < INT64_MAX
+			? arrow_push_ts(bcol + 1U + j, ms[j])
+			: arrow_push_nul(bcol + 1U + j);
+	}
+	rc |= arrow_push_f64(bcol + 5U, b.from[0U]);
+	rc |= arrow_push_f64(bcol + 6U, b.from[1U]);
+	rc |= arrow_push_f64(bcol + 7U, b.to[0U]);
+	rc |= arrow_push_f64(bcol + 8U, b.to[1U]);
+	if (UNLIKELY(rc < 0)) {
+		return -1;
+	}
+	if (bcol[0U].nrow >= batchz) {
+		return arrow_wr_batch(out, bcol, countof(bcol));
+	}
+	return 0;
+}
+
+int
+boxarrow_end(void(*out)(const char*, size_t))
+{
+	int rc = 0;
+
+	if (bcol[0U].nrow) {
+		rc = arrow_wr_batch(out, bcol, countof(bcol));
+	}
+	arrow_wr_eos(out);
+	arrow_wcol_free(bcol, countof(bcol));
+	return rc;
+}
+
+int
+boxarrow_find(int *ck, int ct[static 4U], int cc[static 4U],
+	      const arrow_rd_t *rd)
+{
+	if ((*ck = arrow_rd_find(rd, bcol[0U].name, ARROW_UTF8)) < 0) {
+		*ck = arrow_rd_find(rd, bcol[0U].name, ARROW_LUTF8);
+	}
+	for (size_t j = 0U; j < 4U; j++) {
+		ct[j] = arrow_rd_find(rd, bcol[1U + j].name, ARROW_TS);
+		cc[j] = arrow_rd_find(rd, bcol[5U + j].name, ARROW_F64);
+	}
+	if (*ck < 0) {
+		/* a key of any other type would merge distinct keys */
+		for (size_t i = 0U; i < rd->ncol; i++) {
+			if (!strcmp(rd->col[i].name, bcol[0U].name)) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* boxarrow.c ends here */
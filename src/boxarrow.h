@@ -0,0 +1,75 @@
+/*** boxarrow.h -- boxes as rows of Arrow IPC streams
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_boxarrow_h_
+#define INCLUDED_boxarrow_h_
+#include <stddef.h>
+#include <stdint.h>
+#include "arrow.h"
+#include "box.h"
+
+/* rows, and thus boxes, per record batch */
+#define BOXARROW_BATCHZ	(65536U)
+
+
+/**
+ * Write the schema of box streams through OUT, the columns being
+ * key, valid_from, valid_till, system_from, system_till as timestamps
+ * and xmin, ymin, xmax, ymax as the box. */
+extern int boxarrow_beg(void(*out)(const char*, size_t));
+
+/**
+ * Append a row of key KEY of length NKEY, or null if KEY is NULL,
+ * box B and its ranges MS as per echs_box_unixms(), open ends become
+ * nulls.  Once there are BATCHZ rows they are written through OUT. */
+extern int
+boxarrow_push(void(*out)(const char*, size_t), size_t batchz,
+	      const char *key, size_t nkey,
+	      echs_box_t b, const int64_t ms[static 4U]);
+
+/**
+ * Write pending rows and the end of the stream through OUT. */
+extern int boxarrow_end(void(*out)(const char*, size_t));
+
+/**
+ * Find the columns of box streams in RD, the key column into CK, the
+ * timestamps into CT and the box coordinates into CC, -1 if missing.
+ * Return -1 if there is a key column but it is no (large) string. */
+extern int
+boxarrow_find(int *ck, int ct[static 4U], int cc[static 4U],
+	      const arrow_rd_t *rd);
+
+#endif	/* INCLUDED_boxarrow_h_ */
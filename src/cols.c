@@ -0,0 +1,197 @@
+/*** cols.c -- picking columns of RFC 4180 CSV or TSV records
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include "cols.h"
+#include "nifty.h"
+
+
+int
+cols_strp(cols_t *c, const char *spec)
+{
+	memset(c->pick, 0, sizeof(c->pick));
+	do {
+		char *on;
+		unsigned long int lo = strtoul(spec, &on, 10), hi = lo;
+
+		if (*on == '-') {
+			hi = strtoul(on + 1U, &on, 10);
+		}
+		if (UNLIKELY(on == spec || !lo || hi < lo || hi > COLS_MAX)) {
+			return -1;
+		} else if (UNLIKELY(*on && *on != ',')) {
+			return -1;
+		}
+		for (unsigned long int i = lo - 1U; i < hi; i++) {
+			c->pick[i / 64U] |= 1ULL << (i % 64U);
+		}
+		spec = on;
+	} while (*spec++);
+	return 0;
+}
+
+static bool
+cols_openp(const cols_t *c, const char *sp, const char *ep, bool quot)
+{
+/* tell if a quoted field is still open at EP, QUOT if one is open at SP,
+ * quotes open fields only at the start of a field, cf. cols_fend() */
+	for (const char *p = sp;; p++) {
+		if (quot || (p < ep && *p == '"')) {
+			/* find the closing quote */
+			for (p += !quot; p < ep; p++) {
+				if (*p != '"') {
+					;
+				} else if (p + 1U < ep && p[1U] == '"') {
+					p++;
+				} else {
+					break;
+				}
+			}
+			if (p >= ep) {
+				return true;
+			}
+			quot = false;
+		}
+		if ((p = memchr(p, c->sep, ep - p)) == NULL) {
+			return false;
+		}
+	}
+}
+
+ssize_t
+cols_getrec(cols_t *c, char **ln, size_t *lz, FILE *fp)
+{
+	ssize_t n = getline(ln, lz, fp);
+
+	if (n <= 0) {
+		return n;
+	}
+	/* a quoted field left open continues on the next line */
+	for (bool quot = cols_openp(c, *ln, *ln + n, false); quot;) {
+		ssize_t m = getline(&c->xln, &c->xlz, fp);
+
+		if (m <= 0) {
+			break;
+		} else if ((size_t)(n + m) >= *lz) {
+			const size_t nuz = 2U * (n + m);
+			char *nu = realloc(*ln, nuz);
+
+			if (UNLIKELY(nu == NULL)) {
+				return -1;
+			}
+			*ln = nu;
+			*lz = nuz;
+		}
+		memcpy(*ln + n, c->xln, m + 1U);
+		quot = cols_openp(c, *ln + n, *ln + n + m, true);
+		n += m;
+	}
+	return n;
+}
+
+const char*
+cols_fend(const cols_t *c, const char *sp, const char *ep)
+{
+	const char *p = sp;
+
+	if (p < ep && *p == '"') {
+		/* find the closing quote */
+		for (p++; p < ep; p++) {
+			if (*p != '"') {
+				;
+			} else if (p + 1U < ep && p[1U] == '"') {
+				p++;
+			} else {
+				break;
+			}
+		}
+		if (p >= ep) {
+			return ep;
+		}
+	}
+	return memchr(p, c->sep, ep - p) ?: ep;
+}
+
+const char*
+cols_field(cols_t *c, size_t *n, const char *sp, size_t len)
+{
+	size_t k = 0U;
+
+	if (!len || *sp != '"') {
+		*n = len;
+		return sp;
+	} else if (UNLIKELY(len > c->zbuf)) {
+		const size_t nuz = 2U * len;
+		char *nu = realloc(c->buf, nuz);
+
+		if (UNLIKELY(nu == NULL)) {
+			*n = len;
+			return sp;
+		}
+		c->buf = nu;
+		c->zbuf = nuz;
+	}
+	for (size_t i = 1U; i < len; i++) {
+		if (sp[i] != '"') {
+			c->buf[k++] = sp[i];
+		} else if (i + 1U < len && sp[i + 1U] == '"') {
+			c->buf[k++] = sp[++i];
+		} else {
+			/* anything past the closing quote goes verbatim */
+			memcpy(c->buf + k, sp + i + 1U, len - i - 1U);
+			k += len - i - 1U;
+			break;
+		}
+	}
+	*n = k;
+	return c->buf;
+}
+
+void
+cols_fini(cols_t *c)
+{
+	free(c->buf);
+	free(c->xln);
+	c->buf = c->xln = NULL;
+	c->zbuf = c->xlz = 0U;
+	return;
+}
+
+/* cols.c ends here */
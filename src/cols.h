@@ -0,0 +1,92 @@
+/*** cols.h -- picking columns of RFC 4180 CSV or TSV records
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_cols_h_
+#define INCLUDED_cols_h_
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define COLS_MAX	(1024U)
+
+typedef struct {
+	/* field separator, ',' or '\t' */
+	char sep;
+	/* columns picked, bit I for the (I+1)-th column */
+	uint64_t pick[COLS_MAX / 64U];
+	/* unquoted fields */
+	char *buf;
+	size_t zbuf;
+	/* continuation lines of records */
+	char *xln;
+	size_t xlz;
+} cols_t;
+
+
+/**
+ * Pick the columns in SPEC, a comma-separated list of 1-based column
+ * numbers or ranges thereof, e.g. 2,4-6, return -1 on error. */
+extern int cols_strp(cols_t *c, const char *spec);
+
+/**
+ * Like getline(3) but records continue on the next line while a
+ * quoted field is open. */
+extern ssize_t cols_getrec(cols_t *c, char **ln, size_t *lz, FILE *fp);
+
+/**
+ * Return the end of the field starting at SP, i.e. the next
+ * separator outside quotes or EP. */
+extern const char *cols_fend(const cols_t *c, const char *sp, const char *ep);
+
+/**
+ * Return the contents of the field SP of length LEN, unquoted, and
+ * their length in N, valid until the next call. */
+extern const char*
+cols_field(cols_t *c, size_t *n, const char *sp, size_t len);
+
+/**
+ * Free resources of C. */
+extern void cols_fini(cols_t *c);
+
+static inline bool
+cols_pick_p(const cols_t *c, size_t i)
+{
+	return i < COLS_MAX && (c->pick[i / 64U] >> (i % 64U)) & 1U;
+}
+
+#endif	/* INCLUDED_cols_h_ */
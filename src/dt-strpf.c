@@ -41,7 +41,10 @@
 #if defined HAVE_CONFIG_H
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include "dt-strpf.h"
 #include "nifty.h"
 
@@ -602,41 +605,270 @@ out:
 }
 
 
-echs_range_t
-range_strp(const char *str, char **on, size_t len)
+static const char*
+caldur_strp(int *mon, echs_idiff_t *dur, const char *sp, const char *ep)
 {
-	char *op = deconst(str);
-	echs_range_t r;
+/* ISO 8601 durations PnYnMnWnDTnHnMnS, years and months go into MON
+ * as calendar months, the rest into DUR, return where parsing stopped
+ * or NULL if nothing could be read or the duration is zero */
+	static const char dunits[] = "YMWD";
+	static const char tunits[] = "HMS";
+	const char *u = dunits;
+	bool tp = false;
+	uint64_t m = 0U, dd = 0U, msd = 0U;
+
+	if (UNLIKELY(sp + 1 >= ep || *sp++ != 'P')) {
+		return NULL;
+	}
+	while (sp < ep) {
+		const char *np = sp;
+		const char *up;
+		uint64_t val = 0U;
+
+		if (*sp == 'T' && !tp) {
+			/* switch to time snarfing */
+			u = tunits;
+			tp = true;
+			sp++;
+			continue;
+		}
+		for (; sp < ep && (unsigned char)(*sp ^ '0') < 10U; sp++) {
+			if (UNLIKELY((val = 10U * val + (*sp ^ '0')) > 99999999U)) {
+				return NULL;
+			}
+		}
+		if (sp == np) {
+			break;
+		} else if (UNLIKELY(sp >= ep || !*sp ||
+				    (up = strchr(u, *sp)) == NULL)) {
+			/* units must come in order */
+			return NULL;
+		}
+		switch (*sp++ | tp << 7U) {
+		case 'Y':
+			m += 12U * val;
+			break;
+		case 'M':
+			m += val;
+			break;
+		case 'W':
+			dd += 7U * val;
+			break;
+		case 'D':
+			dd += val;
+			break;
+		case 'H' | 0x80U:
+			msd += val * MSECS_PER_SEC * SECS_PER_MIN * MINS_PER_HOUR;
+			break;
+		case 'M' | 0x80U:
+			msd += val * MSECS_PER_SEC * SECS_PER_MIN;
+			break;
+		case 'S' | 0x80U:
+			msd += val * MSECS_PER_SEC;
+			break;
+		}
+		u = up + 1U;
+	}
+	if (UNLIKELY(sp[-1] == 'P' || sp[-1] == 'T')) {
+		return NULL;
+	} else if (UNLIKELY(!m && !dd && !msd)) {
+		/* nothing long spans no range */
+		return NULL;
+	}
+	dd += msd / MSECS_PER_DAY;
+	if (UNLIKELY(m > 1200000U || dd > INT32_MAX / 2)) {
+		return NULL;
+	}
+	*mon = (int)m;
+	*dur = (echs_idiff_t){(int32_t)dd, (uint32_t)(msd % MSECS_PER_DAY)};
+	return sp;
+}
+
+static echs_idiff_t
+idiff_mul(echs_idiff_t x, unsigned int k)
+{
+	const uint64_t ms = (uint64_t)x.intra * k;
+
+	return (echs_idiff_t){
+		x.dpart * (int32_t)k + (int32_t)(ms / MSECS_PER_DAY),
+		(uint32_t)(ms % MSECS_PER_DAY)};
+}
+
+static echs_instant_t
+instant_addcal(echs_instant_t i, int mon, echs_idiff_t dur, bool negp)
+{
+/* add MON months and DUR to I, or subtract them if NEGP, days beyond
+ * the end of the month are cut back */
+	if (negp) {
+		i = echs_instant_add(i, echs_idiff_neg(dur));
+		mon = -mon;
+	}
+	if (mon) {
+		int m = (int)i.m - 1 + mon;
+		int y = (int)i.y + m / 12;
+		unsigned int md;
+
+		if ((m %= 12) < 0) {
+			m += 12, y--;
+		}
+		i.y = y, i.m = m + 1;
+		md = echs_get_mdays(i.y, i.m);
+		if (i.d > md) {
+			i.d = md;
+		}
+	}
+	return negp ? i : echs_instant_add(i, dur);
+}
+
+size_t
+rrange_strp(
+	echs_range_t *restrict r, size_t nr,
+	const char *str, char **on, size_t len)
+{
+	const char *const ep = str + len;
+	const char *sp = str;
+	char *op = NULL;
+	unsigned int n = 1U;
+	int mon = 0;
+	echs_idiff_t dur = {0};
+	echs_range_t x;
+	enum {
+		RNG_ENDS,
+		RNG_BEGDUR,
+		RNG_DUREND,
+	} form = RNG_ENDS;
 
 	if (UNLIKELY(!len)) {
 		goto err;
-	} else if (*str == '-') {
+	} else if (*sp == 'R') {
+		/* repeating, bounded ones only */
+		for (n = 0U, sp++;
+		     sp < ep && (unsigned char)(*sp ^ '0') < 10U; sp++) {
+			if (UNLIKELY((n = 10U * n + (*sp ^ '0')) > RRANGE_MAX)) {
+				goto err;
+			}
+		}
+		if (UNLIKELY(!n || sp >= ep || *sp++ != '/')) {
+			goto err;
+		}
+	}
+	if (UNLIKELY(sp >= ep)) {
+		goto err;
+	} else if (*sp == 'P') {
+		/* duration, then the end */
+		if (UNLIKELY((sp = caldur_strp(&mon, &dur, sp, ep)) == NULL ||
+			     sp >= ep || *sp++ != '/')) {
+			goto err;
+		}
+		x.beg = echs_min_instant();
+		x.end = dt_strp(sp, &op, ep - sp);
+		form = RNG_DUREND;
+	} else if (*sp == '-') {
 		/* ah, lower bound seems to be -infty */
-		r.beg = echs_min_instant();
-		op++;
-		goto strp_end;
+		x.beg = echs_min_instant();
+		x.end = dt_strp(sp + 1U, &op, ep - sp - 1U);
 	} else {
-		r.beg = dt_strp(str, &op, len);
+		x.beg = dt_strp(sp, &op, ep - sp);
+		if (UNLIKELY(echs_nul_instant_p(x.beg))) {
+			goto err;
+		}
+		switch (*op++) {
+		case '/':
+			if (op < ep && *op == 'P') {
+				/* the start and a duration */
+				op = deconst(caldur_strp(&mon, &dur, op, ep));
+				x.end = echs_max_instant();
+				form = RNG_BEGDUR;
+			} else {
+				/* just a normal range then, innit? */
+				x.end = dt_strp(op, &op, ep - op);
+			}
+			break;
+		case '+':
+			x.end = echs_max_instant();
+			break;
+		default:
+			/* huh? */
+			goto err;
+		}
+	}
+	if (UNLIKELY(op == NULL || echs_nul_instant_p(x.end))) {
+		goto err;
 	}
-	switch (*op++) {
-	strp_end:
-	case '/':
-		/* just a normal range then, innit? */
-		r.end = dt_strp(op, on, len - (op - str));
+
+	switch (form) {
+	case RNG_ENDS:
+		if (n == 1U) {
+			/* as is */
+			if (nr) {
+				r[0U] = x;
+			}
+			break;
+		} else if (UNLIKELY(echs_min_instant_p(x.beg) ||
+				    echs_max_instant_p(x.end))) {
+			goto err;
+		}
+		/* repeat by the length of the range */
+		x = echs_range_unfix(x);
+		dur = echs_instant_diff(x.end, x.beg);
+		if (UNLIKELY(dur.dpart < 0)) {
+			goto err;
+		}
+		/*@fallthrough@*/
+	case RNG_BEGDUR:
+		x = echs_range_unfix(x);
+		for (unsigned int k = 0U; k < n && k < nr; k++) {
+			r[k] = echs_range_fixup((echs_range_t){
+				instant_addcal(
+					x.beg, k * mon, idiff_mul(dur, k),
+					false),
+				instant_addcal(
+					x.beg, (k + 1U) * mon,
+					idiff_mul(dur, k + 1U), false)});
+		}
 		break;
-	case '+':
-		r.end = echs_max_instant();
-		if (on != NULL) {
-			*on = op;
+	case RNG_DUREND:
+		/* counting back from the end, earliest first,
+		 * a time without millis is that very instant */
+		if (x.end.ms == ECHS_ALL_SEC) {
+			x.end.ms = 0U;
+		}
+		x = echs_range_unfix(x);
+		for (unsigned int k = 0U; k < n && k < nr; k++) {
+			const unsigned int j = n - k;
+
+			r[k] = echs_range_fixup((echs_range_t){
+				instant_addcal(
+					x.end, j * mon, idiff_mul(dur, j), true),
+				instant_addcal(
+					x.end, (j - 1U) * mon,
+					idiff_mul(dur, j - 1U), true)});
 		}
 		break;
-	default:
-		/* huh? */
-		goto err;
 	}
-	return r;
+	if (on != NULL) {
+		*on = op;
+	}
+	return n;
 err:
-	return echs_max_range();
+	if (on != NULL) {
+		*on = NULL;
+	}
+	return 0U;
+}
+
+echs_range_t
+range_strp(const char *str, char **on, size_t len)
+{
+	echs_range_t r;
+
+	if (UNLIKELY(rrange_strp(&r, 1U, str, on, len) != 1U)) {
+		if (on != NULL) {
+			*on = NULL;
+		}
+		return echs_max_range();
+	}
+	return r;
 }
 
 size_t
@@ -674,4 +906,111 @@ fin:
 	return n;
 }
 
+static const char*
+epoch_strp1(int64_t *ms, const char *s, const char *ep, bool msp)
+{
+/* one end of an epoch range, NULL if it doesn't parse or overflows */
+	uint64_t x = 0U;
+	const bool negp = s < ep && *s == '-';
+	const char *p = s + negp;
+
+	for (; p < ep && (unsigned char)(*p ^ '0') < 10U; p++) {
+		if (UNLIKELY(x > (INT64_MAX - 9) / 10)) {
+			return NULL;
+		}
+		x = 10U * x + (*p ^ '0');
+	}
+	if (UNLIKELY(p == s + negp)) {
+		return NULL;
+	} else if (!msp) {
+		/* seconds, with millis after the dot, finer digits go */
+		unsigned int f = 0U, k = 0U;
+
+		if (p < ep && *p == '.') {
+			for (p++; p < ep && (unsigned char)(*p ^ '0') < 10U; p++) {
+				if (k < 3U) {
+					f = 10U * f + (*p ^ '0'), k++;
+				}
+			}
+		}
+		for (; k < 3U; k++) {
+			f *= 10U;
+		}
+		if (UNLIKELY(x > (INT64_MAX - 999) / 1000)) {
+			return NULL;
+		}
+		x = 1000U * x + f;
+	}
+	*ms = negp ? -(int64_t)x : (int64_t)x;
+	return p;
+}
+
+int
+epoch_range_strp(
+	int64_t ms[static 2U], const char *str, char **on, size_t len, bool msp)
+{
+	const char *const ep = str + len;
+	const char *p = str;
+
+	ms[0U] = INT64_MIN;
+	ms[1U] = INT64_MAX;
+	if (p < ep && *p != '/' &&
+	    UNLIKELY((p = epoch_strp1(ms + 0U, p, ep, msp)) == NULL)) {
+		goto err;
+	} else if (UNLIKELY(p >= ep || *p++ != '/')) {
+		goto err;
+	} else if (p < ep && (*p == '-' || (unsigned char)(*p ^ '0') < 10U) &&
+		   UNLIKELY((p = epoch_strp1(ms + 1U, p, ep, msp)) == NULL)) {
+		goto err;
+	}
+	if (on != NULL) {
+		*on = deconst(p);
+	}
+	return 0;
+err:
+	if (on != NULL) {
+		*on = NULL;
+	}
+	return -1;
+}
+
+static size_t
+epoch_strf1(char *restrict buf, size_t bsz, int64_t ms, bool msp)
+{
+	const uint64_t x = ms < 0 ? -(uint64_t)ms : (uint64_t)ms;
+	int n;
+
+	if (ms == INT64_MIN || ms == INT64_MAX) {
+		/* open ends are empty */
+		return 0U;
+	} else if (msp || !(x % 1000U)) {
+		n = snprintf(buf, bsz, "%" PRId64, msp ? ms : ms / 1000);
+	} else {
+		n = snprintf(buf, bsz, "%s%" PRIu64 ".%03u",
+			     "-" + (ms >= 0), x / 1000U, (unsigned int)(x % 1000U));
+	}
+	return n < 0 ? 0U : (size_t)n < bsz ? (size_t)n : bsz - 1U;
+}
+
+size_t
+epoch_range_strf(
+	char *restrict buf, size_t bsz, const int64_t ms[static 2U], bool msp)
+{
+	size_t n;
+
+	if (UNLIKELY(bsz < 2U)) {
+		if (bsz) {
+			*buf = '\0';
+		}
+		return 0U;
+	}
+	n = epoch_strf1(buf, bsz, ms[0U], msp);
+	if (n + 1U < bsz) {
+		buf[n++] = '/';
+	}
+	n += epoch_strf1(buf + n, bsz - n, ms[1U], msp);
+	buf[n] = '\0';
+	return n;
+}
+
 #endif	/* INCLUDED_dt_strpf_c_ */
@@ -38,6 +38,8 @@
 #define INCLUDED_dt_strpf_h_
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include "instant.h"
 #include "range.h"
 
@@ -62,11 +64,40 @@ extern echs_idiff_t idiff_strp(const char *str, char **on, size_t len);
 extern size_t idiff_strf(char *restrict buf, size_t bsz, echs_idiff_t idiff);
 
 /**
- * Parse STR as range with the standard parser. */
+ * Parse STR as range with the standard parser, BEG/END, -END, BEG+,
+ * BEG/DURATION or DURATION/END. */
 extern echs_range_t range_strp(const char *str, char **on, size_t len);
 
+/**
+ * Parse STR as range like range_strp() or as ISO 8601 repeating range
+ * Rn/RANGE, with RANGE of the forms BEG/END, BEG/DURATION or
+ * DURATION/END and n at most RRANGE_MAX.  Put up to NR occurrences,
+ * earliest first, into R and return their number, which may exceed NR,
+ * or 0 if STR doesn't parse.  Durations may have years and months. */
+#define RRANGE_MAX	(65536U)
+extern size_t
+rrange_strp(
+	echs_range_t *restrict r, size_t nr,
+	const char *str, char **on, size_t len);
+
 /**
  * Print RANGE into BUF (of size BSZ) in ISO format and return its length. */
 extern size_t range_strf(char *restrict buf, size_t bsz, echs_range_t range);
 
+/**
+ * Parse STR as range of Unix epoch seconds, or milliseconds if MSP, of
+ * the form BEG/END, either end may be empty for open, into milliseconds
+ * MS[0U] and MS[1U], open ends become INT64_MIN and INT64_MAX.  Seconds
+ * may have up to 3 decimals.  Return -1 if STR doesn't parse. */
+extern int
+epoch_range_strp(
+	int64_t ms[static 2U], const char *str, char **on, size_t len, bool msp);
+
+/**
+ * Print milliseconds MS[0U] and MS[1U] into BUF (of size BSZ) the way
+ * epoch_range_strp() reads them and return the length. */
+extern size_t
+epoch_range_strf(
+	char *restrict buf, size_t bsz, const int64_t ms[static 2U], bool msp);
+
 #endif	/* INCLUDED_dt_strpf_h_ */
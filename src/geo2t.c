@@ -41,153 +41,216 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
-#include <math.h>
 #include <time.h>
 #include "dt-strpf.h"
+#include "box.h"
+#include "boxarrow.h"
+#include "cols.h"
 #include "nifty.h"
 
-static const echs_instant_t reftm = {
-	.y = 2000,
-	.m = 1,
-	.d = 1,
-	.H = 0,
-	.M = 0,
-	.S = 0,
-	.ms = 0,
-};
-
-#define MAX_GEOFLT	(90. * 128.)
-#define MIN_GEOFLT	(-MAX_GEOFLT)
-
 
-/* time and geo magic */
-static inline __attribute__((const, pure)) echs_idiff_t
-geoflt2idiff(double x)
+static void
+geo2t(echs_box_t b, const double *z, const int64_t *ms)
 {
-	double ipart = trunc(x);
-	return ipart <= MIN_GEOFLT
-		? echs_min_idiff()
-		: ipart >= MAX_GEOFLT
-		? echs_max_idiff()
-		: (echs_idiff_t){
-		(int32_t)ipart,
-			(uint32_t)((x - ipart) * (double)MSECS_PER_DAY)};
+	echs_range_t rng[2U];
+	char buf[384];
+	size_t bi = 0U;
+
+	if (ms != NULL) {
+		/* exact ranges, the box is for the index only */
+		const echs_idrng_t r[2U] = {
+			echs_unixms_idrng(ms + 0U, 0U),
+			echs_unixms_idrng(ms + 2U, 1U),
+		};
+		echs_idrng_range(rng, r);
+	} else {
+		echs_box_range(rng, b);
+	}
+
+	bi += range_strf(buf + bi, sizeof(buf) - bi, rng[0U]);
+	buf[bi++] = ',';
+	buf[bi++] = ' ';
+	bi += range_strf(buf + bi, sizeof(buf) - bi, rng[1U]);
+	if (z != NULL) {
+		/* tri-temporal */
+		buf[bi++] = ',';
+		buf[bi++] = ' ';
+		bi += range_strf(buf + bi, sizeof(buf) - bi, echs_z_range(z));
+	}
+	buf[bi] = '\0';
+	fwrite(buf, 1, bi, stdout);
+	return;
 }
 
+static bool epochms;
+
 static void
-geo2t(double from[static 2U], double to[static 2U])
-{
-	echs_idrng_t v;
-	echs_idrng_t s;
-	echs_range_t valid;
-	echs_range_t systm;
-	char buf[256];
-	size_t z = 0U;
-
-	/* scale */
-#if 1
-	from[0U] = scalbn(from[0U], 7);
-	from[1U] = scalbn(from[1U], 7);
-	to[0U] = scalbn(to[0U], 7);
-	to[1U] = scalbn(to[1U], 7);
-#else
-	from[0U] *= 100.;
-	from[1U] *= 100.;
-	to[0U] *= 100.;
-	to[1U] *= 100.;
-#endif
-
-	v.lower = geoflt2idiff(from[0U]);
-	v.upper = geoflt2idiff(to[0U]);
-	v.upper.dpart -=
-		!echs_max_idiff_p(v.upper) && !v.lower.intra && !v.upper.intra;
-	s.lower = geoflt2idiff(from[1U]);
-	s.upper = geoflt2idiff(to[1U]);
-	valid = echs_range_add(v, reftm);
-	valid.beg.H += ECHS_ALL_DAY +
-		(echs_min_idiff_p(v.lower) || v.lower.intra || v.upper.intra);
-	valid.end.H += ECHS_ALL_DAY +
-		(echs_max_idiff_p(v.upper) || v.lower.intra || v.upper.intra);
-	systm = echs_range_add(s, reftm);
-
-	z += range_strf(buf + z, sizeof(buf) - z, valid);
-	buf[z++] = ',';
-	buf[z++] = ' ';
-	z += range_strf(buf + z, sizeof(buf) - z, systm);
-	buf[z] = '\0';
-	fwrite(buf, 1, z, stdout);
+geo2t_epoch(echs_box_t b, const double *z, const int64_t *xms)
+{
+/* Unix epoch numbers, straight off the box, no calendar */
+	int64_t ms[6U];
+	char buf[192U];
+	size_t bi = 0U;
+
+	if (xms != NULL) {
+		memcpy(ms, xms, 4U * sizeof(*ms));
+	} else {
+		echs_box_unixms(ms, b);
+	}
+	if (z != NULL) {
+		/* tri-temporal */
+		echs_z_unixms(ms + 4U, z);
+	}
+	for (size_t d = 0U; d < 2U + (z != NULL); d++) {
+		if (d) {
+			buf[bi++] = ',';
+			buf[bi++] = ' ';
+		}
+		bi += epoch_range_strf(
+			buf + bi, sizeof(buf) - bi, ms + 2U * d, epochms);
+	}
+	fwrite(buf, 1, bi, stdout);
 	return;
 }
 
-
+static void(*rngf)(echs_box_t, const double*, const int64_t*) = geo2t;
+
+
+static echs_box_t *lbox;
+/* z coordinates of the boxes in LBOX, two per box */
+static double *lz;
+/* exact ranges of the boxes in LBOX, four per box, if LMSP */
+static int64_t *lms;
+static bool lmsp;
+/* records of the boxes in LBOX, i.e. the index of their first box */
+static size_t *lrec;
+static size_t zlbox;
+static bool mergep;
+
 static int
-geo2t_box2d(const char *box, size_t len)
+lbox_room(size_t nb)
 {
-	/* coords */
-	double from[2U];
-	double to[2U];
+	if (UNLIKELY(nb >= zlbox)) {
+		const size_t nuz = (zlbox * 2U) ?: 64U;
+		echs_box_t *nu = realloc(lbox, nuz * sizeof(*lbox));
+		double *nz = realloc(lz, 2U * nuz * sizeof(*lz));
+		int64_t *nm = realloc(lms, 4U * nuz * sizeof(*lms));
+		size_t *nr = realloc(lrec, nuz * sizeof(*lrec));
 
-	/* read over whitespace */
-	for (; len && isspace(*box); box++, len--);
-	with (char *eo = NULL) {
-		from[0U] = strtod(box, &eo);
-		if (UNLIKELY(eo == NULL)) {
-			return -1;
+		if (nu != NULL) {
+			lbox = nu;
 		}
-		len -= eo - box, box = eo;
-	}
-	/* more whitespace */
-	for (; len && isspace(*box); box++, len--);
-	with (char *eo = NULL) {
-		from[1U] = strtod(box, &eo);
-		if (UNLIKELY(eo == NULL)) {
+		if (nz != NULL) {
+			lz = nz;
+		}
+		if (nm != NULL) {
+			lms = nm;
+		}
+		if (nr != NULL) {
+			lrec = nr;
+		}
+		if (UNLIKELY(nu == NULL || nz == NULL || nm == NULL ||
+			     nr == NULL)) {
 			return -1;
 		}
-		len -= eo - box, box = eo;
-	}
-	/* whitespace */
-	for (; len && isspace(*box); box++, len--);
-	if (UNLIKELY(*box++ != ',')) {
-		/* what sort of 2d data is this? */
-		return -1;
+		zlbox = nuz;
 	}
+	return 0;
+}
 
-	for (; len && isspace(*box); box++, len--);
-	with (char *eo = NULL) {
-		to[0U] = strtod(box, &eo);
-		if (UNLIKELY(eo == NULL)) {
+
+
+/* Arrow IPC streams, one row per box, see t2geo */
+static bool arrp;
+static size_t arrz = BOXARROW_BATCHZ;
+
+static void
+wr_stdout(const char *s, size_t n)
+{
+	fwrite(s, 1, n, stdout);
+	return;
+}
+
+static int
+prnt_arrow(const char *key, size_t nkey, size_t nb)
+{
+	for (size_t i = 0U; i < nb; i++) {
+		int64_t ms[4U];
+		const int64_t *xms = lms + 4U * i;
+
+		if (!lmsp) {
+			echs_box_unixms(ms, lbox[i]);
+			xms = ms;
+		}
+		if (UNLIKELY(boxarrow_push(wr_stdout, arrz, key, nkey,
+					   lbox[i], xms) < 0)) {
 			return -1;
 		}
-		len -= eo - box, box = eo;
 	}
-	/* whitespace */
-	for (; len && isspace(*box); box++, len--);
-	with (char *eo = NULL) {
-		to[1U] = strtod(box, &eo);
-		if (UNLIKELY(eo == NULL)) {
-			return -1;
+	return 0;
+}
+
+
+
+static void
+geo2t_rngs(size_t nb, bool trip)
+{
+/* the NB boxes in LBOX as ranges */
+	for (size_t i = 0U; i < nb; i++) {
+		if (i) {
+			fputc(';', stdout);
+			fputc(' ', stdout);
 		}
-		len -= eo - box, box = eo;
+		rngf(lbox[i], trip ? lz + 2U * i : NULL,
+		     lmsp ? lms + 4U * i : NULL);
 	}
+	return;
+}
 
-	geo2t(from, to);
+static int
+geo2t_prnt(const char *key, size_t nkey, size_t nb, bool trip)
+{
+/* output the NB boxes in LBOX of the line prefixed by KEY */
+	if (mergep && !lmsp) {
+		/* exact ranges come joined already */
+		nb = echs_box_merge(lbox, trip ? lz : NULL, lrec, nb);
+	}
+	if (arrp) {
+		return prnt_arrow(key, nkey, nb);
+	}
+	if (key != NULL) {
+		fwrite(key, 1, nkey, stdout);
+		fputc('\t', stdout);
+	}
+	/* geospatial data */
+	geo2t_rngs(nb, trip);
+	/* in which case we finalise the line */
+	fputc('\n', stdout);
 	return 0;
 }
 
 static int
-geo2t_ln(const char *wkt, size_t len)
+geo2t_wkt(size_t *nbp, bool *tripp, const char *wkt, size_t len)
 {
+/* read the boxes of WKT into LBOX, their number into NBP */
 	static const char box[] = "BOX";
 	static const char col[] = "GEOMETRYCOLLECTION";
-	size_t ni = 0U;
+	size_t nb = 0U;
 	size_t wi = 0U;
+	bool trip = false;
+	/* in a nested collection, the pieces of record REC */
+	bool grp = false;
+	size_t rec = 0U;
 	int rc = 0;
 
-	/* allow prefixes */
-	with (const char *wp = memchr(wkt, '\t', len)) {
-		if (wp != NULL) {
-			wi += ++wp - wkt;
-			fwrite(wkt, 1, wi, stdout);
+	/* trailing whitespace */
+	for (; len > 0U && isspace(wkt[len - 1U]); len--);
+	/* CRS IRIs, as in geo:wktLiteral */
+	if (len > 0U && *wkt == '<') {
+		const char *ep = memchr(wkt, '>', len);
+
+		if (ep != NULL) {
+			for (wi = ++ep - wkt; wi < len && isspace(wkt[wi]); wi++);
 		}
 	}
 
@@ -195,9 +258,6 @@ geo2t_ln(const char *wkt, size_t len)
 		if (UNLIKELY(wkt[wi += strlenof(col)] != '(')) {
 			rc = -1;
 			goto out;
-		} else if (UNLIKELY(wkt[--len] != '\n')) {
-			rc = -1;
-			goto out;
 		} else if (UNLIKELY(wkt[--len] != ')')) {
 			rc = -1;
 			goto out;
@@ -207,57 +267,1279 @@ geo2t_ln(const char *wkt, size_t len)
 	}
 	/* read boxes */
 	while (wi + strlenof(box) < len) {
-		const char *eo;
+		echs_box_t b;
+		char *eo = NULL;
 
 		/* overread whitespace and commas */
 		for (; wi < len &&
-			     (isspace(wkt[wi]) || wkt[wi] == ','); wi++, ni++);
+			     (isspace(wkt[wi]) || wkt[wi] == ','); wi++);
 
+		if (grp && wi < len && wkt[wi] == ')') {
+			grp = false;
+			wi++;
+			continue;
+		} else if (!grp && wi + strlenof(col) < len &&
+			   !memcmp(wkt + wi, col, strlenof(col)) &&
+			   wkt[wi + strlenof(col)] == '(') {
+			/* pieces of one record, cf. t2geo --slab */
+			wi += strlenof(col) + 1U;
+			grp = true;
+			rec = nb;
+			continue;
+		}
 		if (memcmp(wkt + wi, box, strlenof(box))) {
 			/* nope, not a box */
 			break;
 		}
-		/* optionally allow 2D */
-		if (wkt[wi += strlenof(box)] == '2') {
-			if (UNLIKELY(wkt[++wi] != 'D')) {
-				rc = -1;
-				break;
-			}
-			wi++;
-		}
-		if (UNLIKELY(wkt[wi++] != '(')) {
+		if (UNLIKELY(lbox_room(nb) < 0)) {
 			rc = -1;
 			break;
 		}
-		/* find matching paren */
-		eo = memchr(wkt + wi, ')', len - wi);
+		if (wkt[wi + strlenof(box)] == '3') {
+			b = box3_strp(lz + 2U * nb, wkt + wi, &eo, len - wi);
+			trip = true;
+		} else {
+			b = box_strp(wkt + wi, &eo, len - wi);
+			/* in case the line turns out tri-temporal */
+			lz[2U * nb + 0U] = MIN_GEOFLT;
+			lz[2U * nb + 1U] = MAX_GEOFLT;
+		}
 		if (UNLIKELY(eo == NULL)) {
-			/* it's not even a matching pair of parens */
 			rc = -1;
 			break;
 		}
-		/* geospatial data */
-		if (ni) {
-			fputc(';', stdout);
-			fputc(' ', stdout);
-		}
-		rc += geo2t_box2d(wkt + wi, eo - (wkt + wi));
+		lrec[nb] = grp ? rec : nb;
+		lbox[nb++] = b;
 		/* advance wi */
-		wi = ++eo - wkt;
+		wi = eo - wkt;
 	}
 out:
-	/* in which case we finalise the line */
-	fputc('\n', stdout);
+	*nbp = nb;
+	*tripp = trip;
+	return rc;
+}
+
+static int
+geo2t_ln(const char *wkt, size_t len)
+{
+	static const char box[] = "BOX";
+	static const char col[] = "GEOMETRYCOLLECTION";
+	const char *key = NULL;
+	size_t nkey = 0U;
+	size_t nb = 0U;
+	size_t wi = 0U;
+	bool trip = false;
+	int rc = 0;
+
+	/* allow prefixes */
+	with (const char *wp = memchr(wkt, '\t', len)) {
+		if (wp != NULL &&
+		    memcmp(wkt, box, strlenof(box)) &&
+		    memcmp(wkt, col, strlenof(col))) {
+			key = wkt;
+			nkey = wp - wkt;
+			wi += ++wp - wkt;
+		}
+	}
+	/* skip coverings (t2geo --simplify), the exact boxes come last */
+	with (const char *wp = memchr(wkt + wi, '\t', len - wi)) {
+		if (wp != NULL) {
+			wi = ++wp - wkt;
+		}
+	}
+
+	rc = geo2t_wkt(&nb, &trip, wkt + wi, len - wi);
+	rc |= geo2t_prnt(key, nkey, nb, trip);
 	return rc;
 }
 
+static int
+geo2t_arrow(FILE *fp)
+{
+/* rows with the same key in succession make a line */
+	arrow_rd_t rd[1U];
+	int ck, cc[4U], ct[4U];
+	bool boxp = true, tsp = true;
+	char *key = NULL;
+	size_t nkey = 0U;
+	size_t zkey = 0U;
+	bool keyp = false;
+	size_t nb = 0U;
+	ssize_t nr;
+	int rc = 0;
+
+	if (UNLIKELY(arrow_rd_open(rd, fp) < 0)) {
+		fputs("Error: cannot read arrow schema\n", stderr);
+		rc = -1;
+		goto out;
+	}
+	if (UNLIKELY(boxarrow_find(&ck, ct, cc, rd) < 0)) {
+		fputs("Error: key column in arrow input is no string\n",
+		      stderr);
+		rc = -1;
+		goto out;
+	}
+	for (size_t j = 0U; j < countof(cc); j++) {
+		tsp = tsp && ct[j] >= 0;
+		boxp = boxp && cc[j] >= 0;
+	}
+	if (UNLIKELY(!boxp && !tsp)) {
+		fputs("Error: no box or timestamp columns in arrow input\n",
+		      stderr);
+		rc = -1;
+		goto out;
+	}
+	/* timestamps are exact, the boxes are not */
+	lmsp = tsp;
+
+	while ((nr = arrow_rd_next(rd)) > 0) {
+		for (size_t i = 0U; i < (size_t)nr; i++) {
+			const char *k = NULL;
+			size_t nk = 0U;
+			int64_t ms[4U];
+			echs_box_t b;
+
+			for (size_t j = 0U; tsp && j < countof(ms); j++) {
+				const arrow_rcol_t *c = rd->col + ct[j];
+
+				/* nulls are open ends */
+				ms[j] = !arrow_nul_p(c, i)
+					? arrow_ts(c, i)
+					: j % 2U ? INT64_MAX : INT64_MIN;
+			}
+			if (boxp) {
+				double x[4U];
+				bool nulp = false;
+
+				for (size_t j = 0U; j < countof(x); j++) {
+					nulp |= arrow_nul_p(rd->col + cc[j], i);
+					x[j] = arrow_f64(rd->col + cc[j], i);
+				}
+				if (nulp) {
+					/* not a box */
+					continue;
+				}
+				b = (echs_box_t){{x[0U], x[1U]}, {x[2U], x[3U]}};
+			} else {
+				b = echs_unixms_box(ms);
+			}
+
+			if (ck >= 0 && !arrow_nul_p(rd->col + ck, i) &&
+			    UNLIKELY((k = arrow_utf8(rd->col + ck, i, &nk)) == NULL)) {
+				rc = -1;
+				goto out;
+			}
+			if (nb && ((k != NULL) != keyp || nk != nkey ||
+				   (nk && memcmp(k, key, nk)))) {
+				/* key changed, finalise the line */
+				rc |= geo2t_prnt(keyp ? key : NULL, nkey, nb, false);
+				nb = 0U;
+			}
+			if (!nb) {
+				/* keys live in the batch, keep a copy */
+				if (UNLIKELY(nk > zkey)) {
+					char *nu = realloc(key, nk);
+
+					if (UNLIKELY(nu == NULL)) {
+						rc = -1;
+						goto out;
+					}
+					key = nu;
+					zkey = nk;
+				}
+				if (nk) {
+					memcpy(key, k, nk);
+				}
+				nkey = nk;
+				keyp = k != NULL;
+			} else if (tsp &&
+				   !memcmp(lms + 4U * (nb - 1U), ms, sizeof(ms))) {
+				/* another piece of the last box, cf. --slab */
+				lbox[nb - 1U] = echs_box_union(lbox[nb - 1U], b);
+				continue;
+			}
+			if (UNLIKELY(lbox_room(nb) < 0)) {
+				rc = -1;
+				goto out;
+			}
+			lz[2U * nb + 0U] = MIN_GEOFLT;
+			lz[2U * nb + 1U] = MAX_GEOFLT;
+			if (tsp) {
+				memcpy(lms + 4U * nb, ms, sizeof(ms));
+			}
+			lrec[nb] = nb;
+			lbox[nb++] = b;
+		}
+	}
+	if (nb) {
+		rc |= geo2t_prnt(keyp ? key : NULL, nkey, nb, false);
+	}
+	if (UNLIKELY(nr < 0)) {
+		fputs("Error: cannot read arrow record batch\n", stderr);
+		rc = -1;
+	}
+out:
+	free(key);
+	arrow_rd_close(rd);
+	return rc;
+}
+
+
 
+/* GeoJSON, read as a stream without building a document, features
+ * become lines with their properties as prefix columns and the
+ * envelopes of their polygons as boxes, memory stays bounded by the
+ * largest feature */
+#define GJ_MAXDEPTH	(64U)
+#define GJ_MAXPROP	(64U)
+#define GJ_KEYP(k, nk, lit)	\
+	((size_t)(nk) == strlenof(lit) && !memcmp(k, lit, strlenof(lit)))
+
+typedef struct {
+	FILE *fp;
+	/* lookahead and the number of bytes read */
+	int c;
+	size_t off;
+	/* copy what's read to stdout, or to CAP if non-NULL */
+	bool echo;
+	char *cap;
+	size_t ncap;
+	size_t zcap;
+} gj_t;
+
+static const echs_box_t gj_nilbox = {
+	{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+
+/* properties to pick, comma-separated, or NULL for all of them */
+static const char *gjnames;
+static size_t ngjname;
+/* property values of the current feature */
+static char gjpool[65536U];
+static size_t gjpi;
+static struct {
+	size_t off;
+	size_t len;
+} gjprop[GJ_MAXPROP];
+static size_t ngjprop;
+static char gjkey[sizeof(gjpool) + GJ_MAXPROP];
+
+static int
+gj_next(gj_t *j)
+{
+	if (!j->echo || j->c == EOF) {
+		;
+	} else if (j->cap == NULL) {
+		putc_unlocked(j->c, stdout);
+	} else if (j->ncap++ < j->zcap) {
+		j->cap[j->ncap - 1U] = (char)j->c;
+	}
+	j->c = getc_unlocked(j->fp);
+	j->off++;
+	return j->c;
+}
+
+static int
+gj_ws(gj_t *j)
+{
+	/* RS too, for RFC 8142 sequences */
+	for (; isspace(j->c) || j->c == '\036'; gj_next(j));
+	return j->c;
+}
+
+static bool
+gj_eat(gj_t *j, int c)
+{
+	if (gj_ws(j) == c) {
+		gj_next(j);
+		return true;
+	}
+	return false;
+}
+
+static size_t
+utf8_enc(char *restrict buf, long int u)
+{
+	if (u < 0x80) {
+		buf[0U] = (char)u;
+		return 1U;
+	} else if (u < 0x800) {
+		buf[0U] = (char)(0xc0 | u >> 6);
+		buf[1U] = (char)(0x80 | (u & 0x3f));
+		return 2U;
+	} else if (u < 0x10000) {
+		buf[0U] = (char)(0xe0 | u >> 12);
+		buf[1U] = (char)(0x80 | (u >> 6 & 0x3f));
+		buf[2U] = (char)(0x80 | (u & 0x3f));
+		return 3U;
+	}
+	buf[0U] = (char)(0xf0 | u >> 18);
+	buf[1U] = (char)(0x80 | (u >> 12 & 0x3f));
+	buf[2U] = (char)(0x80 | (u >> 6 & 0x3f));
+	buf[3U] = (char)(0x80 | (u & 0x3f));
+	return 4U;
+}
+
+static long int
+gj_hex4(gj_t *j)
+{
+	long int u = 0;
+
+	for (size_t i = 0U; i < 4U; i++) {
+		const int c = gj_next(j);
+
+		if (c >= '0' && c <= '9') {
+			u = u << 4 | (c - '0');
+		} else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+			u = u << 4 | ((c | 0x20) - 'a' + 10);
+		} else {
+			return -1;
+		}
+	}
+	return u;
+}
+
+static ssize_t
+gj_str(gj_t *j, char *restrict buf, size_t bsz)
+{
+/* read a string into BUF (of size BSZ), return its full length,
+ * which may exceed BSZ, or -1 if there's no string */
+	size_t n = 0U;
+
+	if (gj_ws(j) != '"') {
+		return -1;
+	}
+	while (gj_next(j) != '"') {
+		char u[4U];
+		size_t nu = 1U;
+
+		switch (j->c) {
+		case EOF:
+			return -1;
+		case '\\':
+			break;
+		default:
+			if (n < bsz) {
+				buf[n] = (char)j->c;
+			}
+			n++;
+			continue;
+		}
+		switch (gj_next(j)) {
+		case 'b':
+			u[0U] = '\b';
+			break;
+		case 'f':
+			u[0U] = '\f';
+			break;
+		case 'n':
+			u[0U] = '\n';
+			break;
+		case 'r':
+			u[0U] = '\r';
+			break;
+		case 't':
+			u[0U] = '\t';
+			break;
+		case '"':
+		case '\\':
+		case '/':
+			u[0U] = (char)j->c;
+			break;
+		case 'u': {
+			long int cp = gj_hex4(j);
+			long int lo;
+
+			if (UNLIKELY(cp < 0)) {
+				return -1;
+			} else if (cp >= 0xd800 && cp < 0xdc00) {
+				/* surrogate pair */
+				if (gj_next(j) != '\\' || gj_next(j) != 'u' ||
+				    (lo = gj_hex4(j)) < 0xdc00 || lo >= 0xe000) {
+					return -1;
+				}
+				cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+			}
+			nu = utf8_enc(u, cp);
+			break;
+		}
+		default:
+			return -1;
+		}
+		for (size_t i = 0U; i < nu; i++, n++) {
+			if (n < bsz) {
+				buf[n] = u[i];
+			}
+		}
+	}
+	gj_next(j);
+	return n;
+}
+
+static size_t
+gj_tok(gj_t *j, char *restrict buf, size_t bsz)
+{
+/* read a number or literal into BUF, return its full length */
+	size_t n = 0U;
+
+	for (gj_ws(j); j->c != EOF && !isspace(j->c) &&
+		     !strchr(",:[]{}\"", j->c); gj_next(j), n++) {
+		if (n < bsz) {
+			buf[n] = (char)j->c;
+		}
+	}
+	return n;
+}
+
+static int
+gj_num(gj_t *j, double *x)
+{
+	char buf[64U];
+	char *on;
+	const size_t n = gj_tok(j, buf, sizeof(buf));
+
+	if (UNLIKELY(!n || n >= sizeof(buf))) {
+		return -1;
+	}
+	buf[n] = '\0';
+	*x = strtod(buf, &on);
+	return *on ? -1 : 0;
+}
+
+static int
+gj_skip(gj_t *j)
+{
+/* skip a value, nesting is merely counted */
+	size_t d = 0U;
+
+	do {
+		switch (gj_ws(j)) {
+		case '"':
+			if (UNLIKELY(gj_str(j, NULL, 0U) < 0)) {
+				return -1;
+			}
+			break;
+		case '{':
+		case '[':
+			d++;
+			gj_next(j);
+			break;
+		case '}':
+		case ']':
+			if (UNLIKELY(!d--)) {
+				return -1;
+			}
+			gj_next(j);
+			break;
+		case ',':
+		case ':':
+			if (UNLIKELY(!d)) {
+				return -1;
+			}
+			gj_next(j);
+			break;
+		case EOF:
+			return -1;
+		default:
+			if (UNLIKELY(!gj_tok(j, NULL, 0U))) {
+				return -1;
+			}
+			break;
+		}
+	} while (d);
+	return 0;
+}
+
+static int
+gj_push(size_t *nb, echs_box_t b)
+{
+	if (!(b.from[0U] <= b.to[0U] && b.from[1U] <= b.to[1U])) {
+		/* no positions, no box */
+		return 0;
+	} else if (UNLIKELY(lbox_room(*nb) < 0)) {
+		return -1;
+	}
+	lz[2U * *nb + 0U] = MIN_GEOFLT;
+	lz[2U * *nb + 1U] = MAX_GEOFLT;
+	lrec[*nb] = *nb;
+	lbox[(*nb)++] = b;
+	return 0;
+}
+
+static int
+gj_coords(gj_t *j, echs_box_t *env, unsigned int lvl, size_t *nb)
+{
+/* grow ENV by the positions of a coordinates array and return its
+ * nesting depth, if NB is non-NULL push the envelopes of the array's
+ * elements as boxes too */
+	int d = 0;
+
+	if (UNLIKELY(lvl >= GJ_MAXDEPTH || !gj_eat(j, '['))) {
+		return -1;
+	} else if (gj_eat(j, ']')) {
+		return 1;
+	} else if (gj_ws(j) != '[') {
+		/* a position, x and y, z and beyond are ignored */
+		double x[2U];
+		size_t n = 0U;
+
+		do {
+			double v;
+
+			if (UNLIKELY(gj_num(j, &v) < 0)) {
+				return -1;
+			} else if (n < countof(x)) {
+				x[n] = v;
+			}
+			n++;
+		} while (gj_eat(j, ','));
+		if (UNLIKELY(n < countof(x) || !gj_eat(j, ']'))) {
+			return -1;
+		}
+		*env = echs_box_union(*env, (echs_box_t){{x[0U], x[1U]}, {x[0U], x[1U]}});
+		return 1;
+	}
+	do {
+		echs_box_t e = gj_nilbox;
+		const int k = gj_coords(j, &e, lvl + 1U, NULL);
+
+		if (UNLIKELY(k < 0)) {
+			return -1;
+		} else if (nb != NULL && UNLIKELY(gj_push(nb, e) < 0)) {
+			return -1;
+		}
+		*env = echs_box_union(*env, e);
+		d = k > d ? k : d;
+	} while (gj_eat(j, ','));
+	return gj_eat(j, ']') ? d + 1 : -1;
+}
+
+static int
+gj_geom(gj_t *j, size_t *nb, unsigned int lvl)
+{
+/* the polygons of multi-polygons become boxes of their own,
+ * any other geometry makes one box, its envelope */
+	if (gj_ws(j) != '{') {
+		/* null geometries */
+		return gj_skip(j);
+	} else if (UNLIKELY(lvl >= GJ_MAXDEPTH)) {
+		return -1;
+	}
+	gj_next(j);
+	if (gj_eat(j, '}')) {
+		return 0;
+	}
+	do {
+		char k[16U];
+		const ssize_t nk = gj_str(j, k, sizeof(k));
+
+		if (UNLIKELY(nk < 0 || !gj_eat(j, ':'))) {
+			return -1;
+		} else if (GJ_KEYP(k, nk, "coordinates")) {
+			echs_box_t env = gj_nilbox;
+			const size_t nb0 = *nb;
+			const int d = gj_coords(j, &env, 0U, nb);
+
+			if (UNLIKELY(d < 0)) {
+				return -1;
+			} else if (d != 4) {
+				/* not a multi-polygon */
+				*nb = nb0;
+				if (UNLIKELY(gj_push(nb, env) < 0)) {
+					return -1;
+				}
+			}
+		} else if (GJ_KEYP(k, nk, "geometries")) {
+			if (UNLIKELY(!gj_eat(j, '['))) {
+				return -1;
+			} else if (gj_eat(j, ']')) {
+				continue;
+			}
+			do {
+				if (UNLIKELY(gj_geom(j, nb, lvl + 1U) < 0)) {
+					return -1;
+				}
+			} while (gj_eat(j, ','));
+			if (UNLIKELY(!gj_eat(j, ']'))) {
+				return -1;
+			}
+		} else if (UNLIKELY(gj_skip(j) < 0)) {
+			return -1;
+		}
+	} while (gj_eat(j, ','));
+	return gj_eat(j, '}') ? 0 : -1;
+}
+
+static int
+gj_bbox(gj_t *j, echs_box_t *b)
+{
+/* 2d or 3d, z is ignored */
+	double x[6U];
+	size_t n = 0U;
+
+	if (UNLIKELY(!gj_eat(j, '['))) {
+		return -1;
+	}
+	do {
+		double v;
+
+		if (UNLIKELY(gj_num(j, &v) < 0)) {
+			return -1;
+		} else if (n < countof(x)) {
+			x[n] = v;
+		}
+		n++;
+	} while (gj_eat(j, ','));
+	if (UNLIKELY(!gj_eat(j, ']'))) {
+		return -1;
+	}
+	switch (n) {
+	case 4U:
+		*b = (echs_box_t){{x[0U], x[1U]}, {x[2U], x[3U]}};
+		break;
+	case 6U:
+		*b = (echs_box_t){{x[0U], x[1U]}, {x[3U], x[4U]}};
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+static size_t
+gj_find(const char *k, size_t nk)
+{
+/* column of property K, GJ_MAXPROP if not picked */
+	const char *s = gjnames;
+
+	for (size_t i = 0U; i < ngjname; i++) {
+		const char *ep = strchrnul(s, ',');
+
+		if ((size_t)(ep - s) == nk && !memcmp(s, k, nk)) {
+			return i;
+		}
+		s = ep + 1U;
+	}
+	return GJ_MAXPROP;
+}
+
+static int
+gj_props(gj_t *j)
+{
+	if (gj_ws(j) != '{') {
+		/* null properties */
+		return gj_skip(j);
+	}
+	gj_next(j);
+	if (gj_eat(j, '}')) {
+		return 0;
+	}
+	do {
+		char k[256U];
+		const ssize_t nk = gj_str(j, k, sizeof(k));
+		char *const v = gjpool + gjpi;
+		const size_t vz = sizeof(gjpool) - gjpi;
+		ssize_t nv;
+		size_t i;
+
+		if (UNLIKELY(nk < 0 || !gj_eat(j, ':'))) {
+			return -1;
+		}
+		i = gjnames == NULL ? ngjprop
+			: (size_t)nk <= sizeof(k) ? gj_find(k, nk)
+			: GJ_MAXPROP;
+		if (i >= GJ_MAXPROP) {
+			/* not wanted */
+			if (UNLIKELY(gj_skip(j) < 0)) {
+				return -1;
+			}
+			continue;
+		}
+		switch (gj_ws(j)) {
+		case '"':
+			nv = gj_str(j, v, vz);
+			break;
+		case '{':
+		case '[':
+			/* no flattening, objects and arrays come out empty */
+			nv = gj_skip(j);
+			break;
+		default:
+			nv = gj_tok(j, v, vz);
+			if (nv == 4 && !memcmp(v, "null", 4U)) {
+				nv = 0;
+			}
+			break;
+		}
+		if (UNLIKELY(nv < 0)) {
+			return -1;
+		} else if (UNLIKELY((size_t)nv > vz)) {
+			fputs("Error: feature properties too long\n", stderr);
+			return -1;
+		}
+		/* tabs and newlines would break the line */
+		for (ssize_t x = 0; x < nv; x++) {
+			if ((unsigned char)v[x] < ' ') {
+				v[x] = ' ';
+			}
+		}
+		gjprop[i].off = gjpi;
+		gjprop[i].len = nv;
+		gjpi += nv;
+		ngjprop += gjnames == NULL;
+	} while (gj_eat(j, ','));
+	return gj_eat(j, '}') ? 0 : -1;
+}
+
+static int
+gj_prnt(size_t nb)
+{
+	const size_t np = gjnames != NULL ? ngjname : ngjprop;
+	size_t nk = 0U;
+
+	for (size_t i = 0U; i < np; i++) {
+		if (i) {
+			gjkey[nk++] = '\t';
+		}
+		memcpy(gjkey + nk, gjpool + gjprop[i].off, gjprop[i].len);
+		nk += gjprop[i].len;
+	}
+	return geo2t_prnt(np ? gjkey : NULL, nk, nb, false);
+}
+
+static int
+gj_obj(gj_t *j, unsigned int lvl)
+{
+/* collections and features alike, objects with a geometry or
+ * properties make a line, their bbox counts if there's no geometry */
+	echs_box_t bbox = gj_nilbox;
+	bool featp = false;
+	size_t nb = 0U;
+
+	if (UNLIKELY(!gj_eat(j, '{'))) {
+		return -1;
+	}
+	/* start afresh */
+	gjpi = 0U;
+	ngjprop = 0U;
+	for (size_t i = 0U; i < ngjname; i++) {
+		gjprop[i].len = 0U;
+	}
+	if (gj_eat(j, '}')) {
+		return 0;
+	}
+	do {
+		char k[16U];
+		const ssize_t nk = gj_str(j, k, sizeof(k));
+		int rc;
+
+		if (UNLIKELY(nk < 0 || !gj_eat(j, ':'))) {
+			return -1;
+		} else if (GJ_KEYP(k, nk, "features") && !lvl) {
+			if (UNLIKELY(!gj_eat(j, '['))) {
+				return -1;
+			} else if (gj_eat(j, ']')) {
+				continue;
+			}
+			do {
+				if (UNLIKELY(gj_obj(j, lvl + 1U) < 0)) {
+					return -1;
+				}
+			} while (gj_eat(j, ','));
+			rc = -!gj_eat(j, ']');
+		} else if (GJ_KEYP(k, nk, "geometry")) {
+			rc = gj_geom(j, &nb, 0U);
+			featp = true;
+		} else if (GJ_KEYP(k, nk, "properties")) {
+			rc = gj_props(j);
+			featp = true;
+		} else if (GJ_KEYP(k, nk, "bbox")) {
+			rc = gj_bbox(j, &bbox);
+		} else {
+			rc = gj_skip(j);
+		}
+		if (UNLIKELY(rc < 0)) {
+			return -1;
+		}
+	} while (gj_eat(j, ','));
+	if (UNLIKELY(!gj_eat(j, '}'))) {
+		return -1;
+	} else if (!featp) {
+		return 0;
+	} else if (!nb && UNLIKELY(gj_push(&nb, bbox) < 0)) {
+		return -1;
+	}
+	return gj_prnt(nb);
+}
+
+static int
+geo2t_geojson(FILE *fp)
+{
+	gj_t j = {.fp = fp};
+
+	for (gj_next(&j); gj_ws(&j) != EOF;) {
+		if (UNLIKELY(gj_obj(&j, 0U) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse GeoJSON near byte %zu\n", j.off);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+
+/* SPARQL 1.1 query results in TSV, JSON or XML are copied through with
+ * the geo:wktLiteral bindings, or those of the variables picked, turned
+ * into plain literals of ranges, one binding is held at a time */
+#define GEO_WKTLITERAL	"http://www.opengis.net/ont/geosparql#wktLiteral"
+#define SR_MAXBIND	(1U << 20U)
+
+/* variables to convert, comma-separated, or NULL for wkt literals */
+static const char *svars;
+/* the current binding, raw and its value */
+static char *sraw;
+static char *sval;
+/* TSV columns of the variables picked */
+static bool *scol;
+static size_t nscol;
+/* set if values picked could not be converted */
+static int srrc;
+
+static bool
+sr_pick(const char *var, size_t nvar, bool wktp)
+{
+	if (svars == NULL) {
+		return wktp;
+	}
+	for (const char *s = svars, *ep;; s = ep + 1U) {
+		ep = strchrnul(s, ',');
+		if ((size_t)(ep - s) == nvar && !memcmp(s, var, nvar)) {
+			return true;
+		} else if (!*ep) {
+			break;
+		}
+	}
+	return false;
+}
+
+static int
+sr_conv(const char *pre, const char *wkt, size_t len, const char *suf)
+{
+/* print the ranges of WKT between PRE and SUF, nothing if WKT
+ * doesn't convert */
+	size_t nb;
+	bool trip;
+
+	if (geo2t_wkt(&nb, &trip, wkt, len) < 0 || !nb) {
+		srrc = -1;
+		return -1;
+	} else if (mergep) {
+		nb = echs_box_merge(lbox, trip ? lz : NULL, lrec, nb);
+	}
+	fputs(pre, stdout);
+	geo2t_rngs(nb, trip);
+	fputs(suf, stdout);
+	return 0;
+}
+
+static int
+sr_tsv_ln(const char *ln, size_t len, bool hdrp)
+{
+	static const char wktdt[] = "\"^^<" GEO_WKTLITERAL ">";
+	size_t i = 0U;
+
+	/* line endings go, \n comes back */
+	for (; len > 0U && (ln[len - 1U] == '\n' || ln[len - 1U] == '\r'); len--);
+	for (const char *sp = ln, *const ep = ln + len, *tp;
+	     sp <= ep; sp = tp + 1U, i++) {
+		const size_t n = (tp = memchr(sp, '\t', ep - sp) ?: ep) - sp;
+		bool pick;
+
+		if (i) {
+			fputc('\t', stdout);
+		}
+		if (hdrp) {
+			/* ?VAR or $VAR */
+			bool *nu = realloc(scol, (i + 1U) * sizeof(*scol));
+
+			if (UNLIKELY(nu == NULL)) {
+				return -1;
+			}
+			scol = nu;
+			nscol = i + 1U;
+			scol[i] = n > 1U && (*sp == '?' || *sp == '$') &&
+				svars != NULL && sr_pick(sp + 1U, n - 1U, false);
+			pick = false;
+		} else if (svars != NULL) {
+			pick = i < nscol && scol[i];
+		} else {
+			pick = n > strlenof(wktdt) &&
+				!memcmp(tp - strlenof(wktdt), wktdt, strlenof(wktdt));
+		}
+		if (pick && n > 1U && *sp == '"') {
+			/* the lexical form runs up to the last quote */
+			const char *q = memrchr(sp + 1U, '"', n - 1U);
+
+			if (q != NULL && !sr_conv("\"", sp + 1U, q - sp - 1U, "\"")) {
+				continue;
+			}
+		}
+		fwrite(sp, 1, n, stdout);
+	}
+	fputc('\n', stdout);
+	return 0;
+}
+
+static int
+geo2t_srt(FILE *fp)
+{
+	char *line = NULL;
+	size_t llen = 0U;
+	bool hdrp = true;
+	int rc = 0;
+
+	for (ssize_t nrd; (nrd = getline(&line, &llen, fp)) > 0; hdrp = false) {
+		rc |= sr_tsv_ln(line, nrd, hdrp);
+	}
+	free(line);
+	return rc | srrc;
+}
+
+static int
+sr_json_bind(gj_t *j, const char *var, size_t nvar)
+{
+/* capture the binding object, then convert it or pass it on */
+	char dt[64U];
+	ssize_t ndt = -1;
+	ssize_t nval = -1;
+
+	if (gj_ws(j) != '{') {
+		return gj_skip(j);
+	}
+	j->cap = sraw;
+	j->ncap = 0U;
+	j->zcap = SR_MAXBIND;
+	gj_next(j);
+	if (!gj_eat(j, '}')) {
+		do {
+			char k[16U];
+			const ssize_t nk = gj_str(j, k, sizeof(k));
+			ssize_t nv;
+
+			if (UNLIKELY(nk < 0 || !gj_eat(j, ':'))) {
+				goto err;
+			} else if (GJ_KEYP(k, nk, "datatype")) {
+				nv = ndt = gj_str(j, dt, sizeof(dt));
+			} else if (GJ_KEYP(k, nk, "value")) {
+				nv = nval = gj_str(j, sval, SR_MAXBIND);
+			} else {
+				nv = gj_skip(j);
+			}
+			if (UNLIKELY(nv < 0)) {
+				goto err;
+			}
+		} while (gj_eat(j, ','));
+		if (UNLIKELY(!gj_eat(j, '}'))) {
+			goto err;
+		}
+	}
+	j->cap = NULL;
+	if (UNLIKELY(j->ncap > j->zcap || nval > (ssize_t)SR_MAXBIND)) {
+		fputs("Error: binding too long\n", stderr);
+		return -1;
+	}
+	if (nval >= 0 &&
+	    sr_pick(var, nvar, ndt == strlenof(GEO_WKTLITERAL) &&
+		    !memcmp(dt, GEO_WKTLITERAL, ndt)) &&
+	    !sr_conv("{\"type\":\"literal\",\"value\":\"", sval, nval, "\"}")) {
+		return 0;
+	}
+	fwrite(sraw, 1, j->ncap, stdout);
+	return 0;
+err:
+	j->cap = NULL;
+	return -1;
+}
+
+static int
+sr_json_val(gj_t *j, unsigned int ctx)
+{
+/* descend into results, bindings and solutions, skip the rest */
+	enum {SR_ROOT, SR_RESULTS, SR_BINDINGS, SR_SOLUTION};
+
+	if (ctx == SR_BINDINGS) {
+		if (gj_ws(j) != '[') {
+			return gj_skip(j);
+		}
+		gj_next(j);
+		if (gj_eat(j, ']')) {
+			return 0;
+		}
+		do {
+			if (UNLIKELY(sr_json_val(j, SR_SOLUTION) < 0)) {
+				return -1;
+			}
+		} while (gj_eat(j, ','));
+		return gj_eat(j, ']') ? 0 : -1;
+	} else if (gj_ws(j) != '{') {
+		return gj_skip(j);
+	}
+	gj_next(j);
+	if (gj_eat(j, '}')) {
+		return 0;
+	}
+	do {
+		char k[256U];
+		const ssize_t nk = gj_str(j, k, sizeof(k));
+		int rc;
+
+		if (UNLIKELY(nk < 0 || !gj_eat(j, ':'))) {
+			return -1;
+		} else if (ctx == SR_SOLUTION) {
+			rc = (size_t)nk <= sizeof(k)
+				? sr_json_bind(j, k, nk) : gj_skip(j);
+		} else if (ctx == SR_ROOT && GJ_KEYP(k, nk, "results")) {
+			rc = sr_json_val(j, SR_RESULTS);
+		} else if (ctx == SR_RESULTS && GJ_KEYP(k, nk, "bindings")) {
+			rc = sr_json_val(j, SR_BINDINGS);
+		} else {
+			rc = gj_skip(j);
+		}
+		if (UNLIKELY(rc < 0)) {
+			return -1;
+		}
+	} while (gj_eat(j, ','));
+	return gj_eat(j, '}') ? 0 : -1;
+}
+
+static int
+geo2t_srj(FILE *fp)
+{
+	gj_t j = {.fp = fp, .c = EOF, .echo = true};
+
+	gj_next(&j);
+	if (UNLIKELY(sr_json_val(&j, 0U) < 0 || gj_ws(&j) != EOF)) {
+		fprintf(stderr, "\
+Error: cannot parse SPARQL results near byte %zu\n", j.off);
+		return -1;
+	}
+	return srrc;
+}
+
+static size_t
+xml_attr(const char **val, const char *tag, size_t len, const char *name)
+{
+/* point VAL to the value of attribute NAME in TAG, return its length */
+	const char *const ep = tag + len;
+	const size_t nz = strlen(name);
+
+	for (const char *p = tag; (p = memmem(p, ep - p, name, nz)); p += nz) {
+		const char *q = p + nz;
+		const char *e;
+
+		if (!isspace(p[-1])) {
+			continue;
+		}
+		for (; q < ep && isspace(*q); q++);
+		if (q >= ep || *q++ != '=') {
+			continue;
+		}
+		for (; q < ep && isspace(*q); q++);
+		if (q >= ep || (*q != '"' && *q != '\'')) {
+			continue;
+		} else if ((e = memchr(q + 1U, *q, ep - q - 1U)) == NULL) {
+			continue;
+		}
+		*val = q + 1U;
+		return e - q - 1U;
+	}
+	*val = NULL;
+	return 0U;
+}
+
+static bool
+xml_elem_p(const char *tag, size_t len, const char *name)
+{
+	const size_t nz = strlen(name);
+
+	return len > nz + 1U && !memcmp(tag + 1U, name, nz) &&
+		(isspace(tag[nz + 1U]) || tag[nz + 1U] == '>' ||
+		 tag[nz + 1U] == '/');
+}
+
+static size_t
+xml_unesc(char *restrict buf, const char *s, size_t n)
+{
+/* copy character data S of length N into BUF resolving the predefined
+ * entities and character references, others are copied verbatim,
+ * return the length in BUF which never exceeds N */
+	static const struct {
+		const char *ent;
+		char c;
+	} pre[] = {
+		{"lt", '<'}, {"gt", '>'}, {"amp", '&'},
+		{"quot", '"'}, {"apos", '\''},
+	};
+	size_t k = 0U;
+
+	for (size_t i = 0U; i < n; i++) {
+		const char *e;
+		size_t ne;
+
+		if (s[i] != '&' || (e = memchr(s + i, ';', n - i)) == NULL) {
+			buf[k++] = s[i];
+			continue;
+		}
+		ne = e - (s + i + 1U);
+		if (s[i + 1U] == '#') {
+			const bool hexp = s[i + 2U] == 'x';
+			const char *d = s + i + 2U + hexp;
+			char *on;
+			long int u;
+
+			if (hexp ? !isxdigit(*d) : !isdigit(*d)) {
+				goto verb;
+			}
+			u = strtol(d, &on, hexp ? 16 : 10);
+			if (on == e && u > 0 && u <= 0x10ffff) {
+				k += utf8_enc(buf + k, u);
+				i += ne + 1U;
+				continue;
+			}
+			goto verb;
+		}
+		for (size_t j = 0U; j < countof(pre); j++) {
+			if (strlen(pre[j].ent) == ne &&
+			    !memcmp(s + i + 1U, pre[j].ent, ne)) {
+				buf[k++] = pre[j].c;
+				i += ne + 1U;
+				goto next;
+			}
+		}
+	verb:
+		buf[k++] = s[i];
+	next:
+		;
+	}
+	return k;
+}
+
+static int
+geo2t_srx(FILE *fp)
+{
+	static char tag[4096U];
+	char var[256U];
+	size_t nvar = 0U;
+	int c;
+
+	while ((c = getc_unlocked(fp)) != EOF) {
+		size_t nt = 0U;
+
+		if (c != '<') {
+			putc_unlocked(c, stdout);
+			continue;
+		}
+		/* tags are read whole */
+		for (tag[nt++] = '<'; (c = getc_unlocked(fp)) != EOF && c != '>';) {
+			if (UNLIKELY(nt >= sizeof(tag) - 1U)) {
+				goto err;
+			}
+			tag[nt++] = (char)c;
+		}
+		if (UNLIKELY(c == EOF)) {
+			goto err;
+		}
+		tag[nt++] = '>';
+		if (xml_elem_p(tag, nt, "binding")) {
+			const char *v;
+			const size_t n = xml_attr(&v, tag, nt, "name");
+
+			nvar = n < sizeof(var) ? n : 0U;
+			memcpy(var, v, nvar);
+		} else if (xml_elem_p(tag, nt, "literal") && tag[nt - 2U] != '/') {
+			const char *dt;
+			const size_t ndt = xml_attr(&dt, tag, nt, "datatype");
+			size_t nv = 0U;
+
+			if (sr_pick(var, nvar, ndt == strlenof(GEO_WKTLITERAL) &&
+				    !memcmp(dt, GEO_WKTLITERAL, ndt))) {
+				/* the text, the closing tag is copied as usual */
+				while ((c = getc_unlocked(fp)) != EOF && c != '<') {
+					if (UNLIKELY(nv >= SR_MAXBIND)) {
+						goto err;
+					}
+					sraw[nv++] = (char)c;
+				}
+				if (UNLIKELY(c == EOF)) {
+					goto err;
+				}
+				ungetc(c, fp);
+				/* entities are resolved, e.g. &lt;CRS&gt; */
+				if (sr_conv("<literal>", sval,
+					    xml_unesc(sval, sraw, nv), "") < 0) {
+					fwrite(tag, 1, nt, stdout);
+					fwrite(sraw, 1, nv, stdout);
+				}
+				continue;
+			}
+		}
+		fwrite(tag, 1, nt, stdout);
+	}
+	return srrc;
+err:
+	fputs("Error: cannot parse SPARQL results\n", stderr);
+	return -1;
+}
+
+
+/* picked columns of CSV or TSV records */
+static cols_t cols[1U] = {{.sep = '\t'}};
+
+static int
+geo2t_cols(const char *ln, size_t len)
+{
+/* convert picked columns in place, pass on the rest */
+	size_t ez = 0U;
+	size_t i = 0U;
+	int rc = 0;
+
+	/* line endings are kept */
+	ez += len > ez && ln[len - ez - 1U] == '\n';
+	ez += ez && len > ez && ln[len - ez - 1U] == '\r';
+	for (const char *sp = ln, *const ep = ln + len - ez, *fp;
+	     sp <= ep; sp = fp + 1U, i++) {
+		/* ranges have commas */
+		const char *q = (sp < ep && *sp == '"') || cols->sep == ','
+			? "\"" : "";
+		const char *s;
+		size_t n;
+
+		fp = cols_fend(cols, sp, ep);
+		if (i) {
+			fputc(cols->sep, stdout);
+		}
+		if (!cols_pick_p(cols, i) || sp == fp) {
+			fwrite(sp, 1, fp - sp, stdout);
+			continue;
+		}
+		s = cols_field(cols, &n, sp, fp - sp);
+		if (UNLIKELY(sr_conv(q, s, n, q) < 0)) {
+			fwrite(sp, 1, fp - sp, stdout);
+			rc = -1;
+		}
+	}
+	fwrite(ln + len - ez, 1, ez, stdout);
+	return rc;
+}
+
+
 #include "geo2t.yucc"
 
 int
 main(int argc, char *argv[])
 {
 	yuck_t argi[1U];
+	int(*rd)(FILE*) = NULL;
 	int rc = 0;
 
 	if (yuck_parse(argi, argc, argv) < 0) {
@@ -265,16 +1547,150 @@ main(int argc, char *argv[])
 		goto out;
 	}
 
-	if (!argi->nargs) {
+	with (echs_boxmap_t m = echs_box_defmap) {
+		if (UNLIKELY(echs_boxmap_strp(
+				     &m, argi->epoch_arg, argi->scale_arg,
+				     argi->warp_arg) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse epoch, scale or warp\n");
+			rc = 1;
+			goto out;
+		}
+		echs_box_setmap(m);
+	}
+	mergep = argi->merge_flag;
+	if (argi->format_arg) {
+		if (!strcmp(argi->format_arg, "arrow")) {
+			arrp = true;
+		} else if (!strcmp(argi->format_arg, "epoch-s") ||
+			   (epochms = !strcmp(argi->format_arg, "epoch-ms"))) {
+			rngf = geo2t_epoch;
+		} else if (UNLIKELY(strcmp(argi->format_arg, "text"))) {
+			fprintf(stderr, "\
+Error: unknown output format `%s'\n", argi->format_arg);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->input_arg) {
+		static const struct {
+			const char *name;
+			int(*rd)(FILE*);
+		} ins[] = {
+			{"wkt", NULL},
+			{"arrow", geo2t_arrow},
+			{"geojson", geo2t_geojson},
+			{"sparql-tsv", geo2t_srt},
+			{"sparql-json", geo2t_srj},
+			{"sparql-xml", geo2t_srx},
+		};
+		size_t i;
+
+		for (i = 0U; i < countof(ins) &&
+			     strcmp(argi->input_arg, ins[i].name); i++);
+		if (UNLIKELY(i >= countof(ins))) {
+			fprintf(stderr, "\
+Error: unknown input format `%s'\n", argi->input_arg);
+			rc = 1;
+			goto out;
+		}
+		rd = ins[i].rd;
+	}
+	if (argi->csv_flag) {
+		cols->sep = ',';
+	}
+	if (argi->columns_arg) {
+		if (UNLIKELY(cols_strp(cols, argi->columns_arg) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse columns `%s'\n", argi->columns_arg);
+			rc = 1;
+			goto out;
+		} else if (UNLIKELY(arrp || rd != NULL)) {
+			fputs("\
+Error: columns need wkt input and text output\n", stderr);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (!strncmp(argi->input_arg ?: "", "sparql-", 7U)) {
+		if (UNLIKELY(arrp)) {
+			fputs("\
+Error: arrow output cannot be used with sparql input\n", stderr);
+			rc = 1;
+			goto out;
+		} else if (UNLIKELY((sraw = malloc(SR_MAXBIND)) == NULL ||
+				    (sval = malloc(SR_MAXBIND)) == NULL)) {
+			rc = 1;
+			goto out;
+		}
+		svars = argi->vars_arg;
+	}
+	if ((gjnames = argi->properties_arg) != NULL) {
+		ngjname = 1U;
+		for (const char *p = gjnames; (p = strchr(p, ',')); p++) {
+			ngjname++;
+		}
+		if (UNLIKELY(ngjname > GJ_MAXPROP)) {
+			fprintf(stderr, "\
+Error: at most %u properties can be picked\n", GJ_MAXPROP);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->batch_size_arg) {
+		char *on = NULL;
+		unsigned long int n = strtoul(argi->batch_size_arg, &on, 10);
+
+		if (UNLIKELY(*on || !n || n > 16777216U)) {
+			fprintf(stderr, "\
+Error: batch-size must be between 1 and 16777216\n");
+			rc = 1;
+			goto out;
+		}
+		arrz = n;
+	}
+	if (arrp) {
+		rc |= boxarrow_beg(wr_stdout) < 0;
+	}
+
+	if (!argi->nargs && rd != NULL) {
+		rc |= rd(stdin) < 0;
+	} else if (!argi->nargs && argi->columns_arg) {
+		char *line = NULL;
+		size_t llen = 0U;
+		ssize_t nrd;
+
+		if (argi->header_flag &&
+		    (nrd = cols_getrec(cols, &line, &llen, stdin)) > 0) {
+			fwrite(line, 1, nrd, stdout);
+		}
+		while ((nrd = cols_getrec(cols, &line, &llen, stdin)) > 0) {
+			rc |= geo2t_cols(line, nrd) < 0;
+		}
+		free(line);
+		cols_fini(cols);
+	} else if (!argi->nargs) {
 		char *line = NULL;
 		size_t llen = 0U;
 
 		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
 			rc |= geo2t_ln(line, nrd) < 0;
 		}
+		free(line);
+	}
+	if (arrp) {
+		/* last batch and end of stream */
+		rc |= boxarrow_end(wr_stdout) < 0;
 	}
+	free(lbox);
+	free(lz);
+	free(lms);
+	free(lrec);
+	free(scol);
 
 out:
+	free(sraw);
+	free(sval);
 	yuck_free(argi);
 	return rc;
 }
@@ -314,4 +314,62 @@ fixup_S:
 	return res;
 }
 
+time_t
+echs_instant_to_epoch(echs_instant_t i)
+{
+	time_t res;
+
+	if (UNLIKELY(echs_instant_all_day_p(i))) {
+		i.H = 0, i.M = 0, i.S = 0, i.ms = 0;
+	} else if (UNLIKELY(echs_instant_all_sec_p(i))) {
+		i.ms = 0;
+	}
+	/* days since 1970-01-01, __jan00(1970) is 134774 */
+	res = (time_t)(__jan00(i.y) + __doy(i)) - 134775;
+	res *= HOURS_PER_DAY;
+	res += i.H;
+	res *= MINS_PER_HOUR;
+	res += i.M;
+	res *= SECS_PER_MIN;
+	res += i.S;
+	return res;
+}
+
+unsigned int
+echs_get_mdays(unsigned int y, unsigned int m)
+{
+	return __get_mdays(y, m);
+}
+
+echs_instant_t
+epoch_to_echs_instant(time_t t)
+{
+/* civil from days, after H. Hinnant's chrono-compatible algorithms */
+	echs_instant_t res = {.u = 0U};
+	long int dd = t / (time_t)SECS_PER_DAY;
+	long int ss = t % (time_t)SECS_PER_DAY;
+	long int era, doe, yoe, dy, mp;
+
+	if (ss < 0) {
+		ss += SECS_PER_DAY;
+		dd--;
+	}
+	/* shift epoch to 0000-03-01 */
+	dd += 719468L;
+	era = (dd >= 0 ? dd : dd - 146096L) / 146097L;
+	doe = dd - era * 146097L;
+	yoe = (doe - doe / 1460L + doe / 36524L - doe / 146096L) / 365L;
+	dy = doe - (365L * yoe + yoe / 4L - yoe / 100L);
+	mp = (5L * dy + 2L) / 153L;
+
+	res.d = dy - (153L * mp + 2L) / 5L + 1L;
+	res.m = mp < 10L ? mp + 3L : mp - 9L;
+	res.y = yoe + era * 400L + (res.m <= 2U);
+	res.H = ss / (long int)(MINS_PER_HOUR * SECS_PER_MIN);
+	res.M = ss / (long int)SECS_PER_MIN % (long int)MINS_PER_HOUR;
+	res.S = ss % (long int)SECS_PER_MIN;
+	res.ms = 0U;
+	return res;
+}
+
 /* instant.c ends here */
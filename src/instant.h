@@ -105,6 +105,10 @@ extern echs_idiff_t echs_instant_diff(echs_instant_t end, echs_instant_t beg);
  * Return the instant yielded by adding a duration ADD to the instant BAS. */
 extern echs_instant_t echs_instant_add(echs_instant_t bas, echs_idiff_t add);
 
+/**
+ * Return the number of days in month M (1 to 12) of year Y. */
+extern unsigned int echs_get_mdays(unsigned int y, unsigned int m);
+
 /**
  * Convert echs_instant_t to epoch time. */
 extern time_t echs_instant_to_epoch(echs_instant_t);
@@ -135,6 +139,26 @@ echs_instant_0_p(echs_instant_t x)
 	return x.u == 0U;
 }
 
+/**
+ * Return X as 64bit key that orders like X, i.e. with the all-day and
+ * all-sec markers wrapped round to 0. */
+static inline __attribute__((const, pure)) uint64_t
+echs_instant_key(echs_instant_t x)
+{
+	x.H++, x.ms++;
+	return x.u;
+}
+
+/**
+ * Return the instant whose key, see `echs_instant_key()', is K. */
+static inline __attribute__((const, pure)) echs_instant_t
+echs_key_instant(uint64_t k)
+{
+	echs_instant_t x = {.u = k};
+	x.H--, x.ms--;
+	return x;
+}
+
 static inline __attribute__((const, pure)) bool
 echs_instant_lt_p(echs_instant_t x, echs_instant_t y)
 {
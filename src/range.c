@@ -62,15 +62,23 @@ echs_range_unfix(echs_range_t r)
 	return r;
 }
 
+static inline bool
+tod_p(echs_instant_t i)
+{
+/* whether I is past midnight, by however little */
+	return i.H < HOURS_PER_DAY &&
+		(i.H || i.M || i.S || i.ms && i.ms < MSECS_PER_SEC);
+}
+
 echs_range_t
 echs_range_fixup(echs_range_t r)
 {
 	unsigned int begfixH =
 		(echs_min_instant_p(r.beg) || r.beg.H ||
-		 r.end.H && r.end.H < HOURS_PER_DAY);
+		 tod_p(r.beg) || tod_p(r.end));
 	unsigned int endfixH =
 		(echs_max_instant_p(r.end) || r.end.H ||
-		 r.beg.H && r.beg.H < HOURS_PER_DAY);
+		 tod_p(r.end) || tod_p(r.beg));
 	unsigned int begfixms =
 		(echs_min_instant_p(r.beg) || r.beg.ms ||
 		 r.end.ms && r.end.ms < MSECS_PER_SEC);
@@ -137,4 +145,81 @@ echs_range_coalesce(echs_range_t r1, echs_range_t r2)
 	return r;
 }
 
+
+/* Allen classification, 4 pairs at a time */
+typedef uint64_t v4u64_t __attribute__((vector_size(32)));
+typedef int64_t v4i64_t __attribute__((vector_size(32)));
+
+/* bit positions of H and ms in echs_instant_t's u slot */
+#define KEY_H	(0xffULL << 24U)
+#define KEY_ms	(0x3ffULL)
+
+/* like echs_instant_key() but 4 at once, the increments of H and ms
+ * must not carry over into their neighbours */
+#define V4_KEY(u)						\
+	(((u) & ~(KEY_H | KEY_ms)) |				\
+	 (((u) + (1ULL << 24U)) & KEY_H) |			\
+	 (((u) + 1ULL) & KEY_ms))
+/* -1 for x < y, 0 for x == y, 1 for x > y,
+ * vector comparisons themselves yield -1 for true */
+#define V4_CMP(x, y)	((v4i64_t)((x) < (y)) - (v4i64_t)((x) > (y)))
+/* lane-wise MSK ? YES : NO */
+#define V4_SEL(msk, yes, no)					\
+	(((v4i64_t)(msk) & (yes)) | (~(v4i64_t)(msk) & (no)))
+#define V4_GET(x, slot)						\
+	(v4u64_t){							\
+		x[i + 0U].slot.u, x[i + 1U].slot.u,		\
+		x[i + 2U].slot.u, x[i + 3U].slot.u}
+
+void
+echs_range_allen_batch(
+	echs_allen_t *restrict rel,
+	const echs_range_t *a, const echs_range_t *b, size_t n)
+{
+	static const v4i64_t before = {
+		ECHS_ALLEN_BEFORE, ECHS_ALLEN_BEFORE,
+		ECHS_ALLEN_BEFORE, ECHS_ALLEN_BEFORE,
+	};
+	static const v4i64_t meets = {
+		ECHS_ALLEN_MEETS, ECHS_ALLEN_MEETS,
+		ECHS_ALLEN_MEETS, ECHS_ALLEN_MEETS,
+	};
+	static const v4i64_t met_by = {
+		ECHS_ALLEN_MET_BY, ECHS_ALLEN_MET_BY,
+		ECHS_ALLEN_MET_BY, ECHS_ALLEN_MET_BY,
+	};
+	static const v4i64_t after = {
+		ECHS_ALLEN_AFTER, ECHS_ALLEN_AFTER,
+		ECHS_ALLEN_AFTER, ECHS_ALLEN_AFTER,
+	};
+	size_t i = 0U;
+
+	for (; i + 4U <= n; i += 4U) {
+		const v4u64_t ab = V4_KEY(V4_GET(a, beg));
+		const v4u64_t ae = V4_KEY(V4_GET(a, end));
+		const v4u64_t bb = V4_KEY(V4_GET(b, beg));
+		const v4u64_t be = V4_KEY(V4_GET(b, end));
+		v4i64_t r;
+
+		/* proper intersection first, see echs_range_allen() */
+		r = ECHS_ALLEN_EQUALS + 3 * V4_CMP(ab, bb) + V4_CMP(ae, be);
+		/* the disjoint and touching cases take precedence,
+		 * so apply them in reverse order of precedence */
+		r = V4_SEL(ab == be, met_by, r);
+		r = V4_SEL(ae == bb, meets, r);
+		r = V4_SEL(ab > be, after, r);
+		r = V4_SEL(ae < bb, before, r);
+
+		rel[i + 0U] = (echs_allen_t)r[0U];
+		rel[i + 1U] = (echs_allen_t)r[1U];
+		rel[i + 2U] = (echs_allen_t)r[2U];
+		rel[i + 3U] = (echs_allen_t)r[3U];
+	}
+	/* the rest */
+	for (; i < n; i++) {
+		rel[i] = echs_range_allen(a[i], b[i]);
+	}
+	return;
+}
+
 /* range.c ends here */
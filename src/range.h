@@ -51,6 +51,25 @@ typedef struct {
 	echs_idiff_t upper;
 } echs_idrng_t;
 
+/**
+ * Allen's 13 relations between two ranges, in canonical order. */
+typedef enum {
+	ECHS_ALLEN_BEFORE,
+	ECHS_ALLEN_MEETS,
+	ECHS_ALLEN_OVERLAPS,
+	ECHS_ALLEN_FINISHED_BY,
+	ECHS_ALLEN_CONTAINS,
+	ECHS_ALLEN_STARTS,
+	ECHS_ALLEN_EQUALS,
+	ECHS_ALLEN_STARTED_BY,
+	ECHS_ALLEN_DURING,
+	ECHS_ALLEN_FINISHES,
+	ECHS_ALLEN_OVERLAPPED_BY,
+	ECHS_ALLEN_MET_BY,
+	ECHS_ALLEN_AFTER,
+	NECHS_ALLEN,
+} echs_allen_t;
+
 
 /**
  * Return the duration of RNG relative to REL. */
@@ -72,6 +91,15 @@ extern echs_range_t echs_range_unfix(echs_range_t r);
  * Treat ranges that start and end on midnight as all-days ranges. */
 extern echs_range_t echs_range_fixup(echs_range_t r);
 
+/**
+ * Classify the N range pairs A[i], B[i] according to Allen and put the
+ * relation of the i-th pair into REL[i].
+ * Ranges are expected to be unfixed, see `echs_range_unfix()'. */
+extern void
+echs_range_allen_batch(
+	echs_allen_t *restrict rel,
+	const echs_range_t *a, const echs_range_t *b, size_t n);
+
 
 static inline __attribute__((const, pure)) echs_idiff_t
 echs_range_dur(echs_range_t r)
@@ -115,6 +143,15 @@ echs_min_range_p(echs_range_t r)
 	return echs_instant_le_p(r.end, r.beg);
 }
 
+/**
+ * Return true iff instant I lies within R, i.e. R.beg <= I < R.end.
+ * I and R are expected to be unfixed, see `echs_range_unfix()'. */
+static inline __attribute__((const, pure)) bool
+echs_in_range_p(echs_instant_t i, echs_range_t r)
+{
+	return echs_instant_le_p(r.beg, i) && echs_instant_lt_p(i, r.end);
+}
+
 /* 2-ary relations */
 /**
  * Return true iff A precedes B, according to Allen. */
@@ -175,4 +212,30 @@ echs_range_equals_p(echs_range_t a, echs_range_t b)
 		echs_instant_eq_p(a.end, b.end);
 }
 
+/**
+ * Return the relation of A to B, according to Allen.
+ * Ranges are expected to be unfixed, see `echs_range_unfix()'. */
+static inline __attribute__((const, pure)) echs_allen_t
+echs_range_allen(echs_range_t a, echs_range_t b)
+{
+	const uint64_t ab = echs_instant_key(a.beg);
+	const uint64_t ae = echs_instant_key(a.end);
+	const uint64_t bb = echs_instant_key(b.beg);
+	const uint64_t be = echs_instant_key(b.end);
+
+	if (ae < bb) {
+		return ECHS_ALLEN_BEFORE;
+	} else if (ab > be) {
+		return ECHS_ALLEN_AFTER;
+	} else if (ae == bb) {
+		return ECHS_ALLEN_MEETS;
+	} else if (ab == be) {
+		return ECHS_ALLEN_MET_BY;
+	}
+	/* proper intersection, beginnings and ends decide */
+	return (echs_allen_t)(ECHS_ALLEN_EQUALS +
+			      3 * ((ab > bb) - (ab < bb)) +
+			      ((ae > be) - (ae < be)));
+}
+
 #endif	/* INCLUDED_range_h_ */
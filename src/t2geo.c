@@ -39,98 +39,1449 @@
 #endif	/* HAVE_CONFIG_H */
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <stdio.h>
 #include <ctype.h>
-#include <math.h>
 #include <time.h>
+#include <math.h>
 #include "dt-strpf.h"
+#include "box.h"
+#include "zorder.h"
+#include "boobs.h"
+#include "boxarrow.h"
+#include "cols.h"
 #include "nifty.h"
 
-static const echs_instant_t reftm = {
-	.y = 2000,
-	.m = 1,
-	.d = 1,
-	.H = 0,
-	.M = 0,
-	.S = 0,
-	.ms = 0,
-};
-static const time_t reftm_time = 946684800/*2000-01-01Z*/;
-static time_t now;
+/* mapping in use, NOW is relative to its system epoch */
+static echs_boxmap_t bmap;
+static time_t now;
+static bool hilbp;
+
+
+/* output buffer, lines are assembled here and written in batches */
+static char *obuf;
+static size_t obz;
+static size_t obi;
+static int oberr;
+
+static void
+obuf_add(const char *s, size_t n)
+{
+	if (UNLIKELY(obi + n > obz)) {
+		size_t nuz = (obz * 2U) ?: 65536U;
+		char *nu;
+
+		for (; nuz < obi + n; nuz *= 2U);
+		if (UNLIKELY((nu = realloc(obuf, nuz)) == NULL)) {
+			oberr = -1;
+			return;
+		}
+		obuf = nu;
+		obz = nuz;
+	}
+	memcpy(obuf + obi, s, n);
+	obi += n;
+	return;
+}
+
+static inline void
+obuf_addc(char c)
+{
+	obuf_add(&c, 1U);
+	return;
+}
+
+static void
+obuf_flush(void)
+{
+	fwrite(obuf, 1, obi, stdout);
+	obi = 0U;
+	return;
+}
+
+
+/* sorting lines by the Hilbert index of their box centres,
+ * lines are collected in memory until SORTZ bytes are used, then
+ * sorted and spilled to a temporary file (a run), eventually all
+ * runs are merged
+ * to keep the number of open files bounded, every MERGE_FANIN runs
+ * of the same level are merged into one run of the next level as
+ * soon as they exist */
+#define MERGE_FANIN	(64U)
+
+typedef struct {
+	uint64_t h;
+	size_t seq;
+	size_t off;
+	size_t len;
+} srec_t;
+
+typedef struct {
+	FILE *fp;
+	unsigned int lvl;
+} run_t;
+
+static srec_t *recs;
+static size_t nrec;
+static size_t zrec;
+static char *sbuf;
+static size_t sbz;
+static size_t sbi;
+static size_t sseq;
+static size_t sortz = 64U * 1024U * 1024U;
+
+static run_t *runs;
+static size_t nruns;
+/* set once spilling or merging failed, it's been reported then */
+static int serr;
+
+static int
+srec_cmp(const void *a, const void *b)
+{
+	const srec_t *x = a;
+	const srec_t *y = b;
+	return (x->h > y->h) - (x->h < y->h) ?:
+		(x->seq > y->seq) - (x->seq < y->seq);
+}
+
+static void
+sort_err(const char *what)
+{
+	if (!serr++) {
+		fprintf(stderr, "\
+Error: cannot %s temporary sort file: %s\n", what, strerror(errno));
+	}
+	return;
+}
+
+static FILE*
+run_open(void)
+{
+	FILE *fp;
+
+	if (UNLIKELY(!(nruns % MERGE_FANIN))) {
+		run_t *nu = realloc(runs, (nruns + MERGE_FANIN) * sizeof(*runs));
+
+		if (UNLIKELY(nu == NULL)) {
+			return NULL;
+		}
+		runs = nu;
+	}
+	if (UNLIKELY((fp = tmpfile()) == NULL)) {
+		sort_err("create");
+		return NULL;
+	}
+	return fp;
+}
+
+static int
+run_close(FILE *fp)
+{
+	if (UNLIKELY(fflush(fp) || ferror(fp))) {
+		sort_err("write");
+		fclose(fp);
+		return -1;
+	}
+	rewind(fp);
+	return 0;
+}
+
+typedef struct {
+	uint64_t h;
+	size_t len;
+	size_t z;
+	char *ln;
+} head_t;
+
+static int
+run_next(head_t *hd, FILE *fp)
+{
+	uint64_t hdr[2U];
+
+	if (fread(hdr, sizeof(hdr), 1U, fp) < 1U) {
+		return -1;
+	}
+	if (UNLIKELY(hdr[1U] > hd->z)) {
+		char *nu = realloc(hd->ln, hdr[1U]);
+
+		if (UNLIKELY(nu == NULL)) {
+			return -1;
+		}
+		hd->ln = nu;
+		hd->z = hdr[1U];
+	}
+	if (UNLIKELY(fread(hd->ln, 1, hdr[1U], fp) < hdr[1U])) {
+		return -1;
+	}
+	hd->h = hdr[0U];
+	hd->len = hdr[1U];
+	return 0;
+}
+
+static inline bool
+head_lt_p(const head_t *hds, size_t i, size_t j)
+{
+	/* ties go to the earlier run, keeping input order */
+	return hds[i].h < hds[j].h || (hds[i].h == hds[j].h && i < j);
+}
+
+static int
+run_merge(FILE *out, const run_t *rs, size_t n)
+{
+/* merge the N runs RS into the run OUT, or to stdout as plain lines
+ * if OUT is NULL */
+	head_t *hds = calloc(n, sizeof(*hds));
+	size_t *hp = calloc(n, sizeof(*hp));
+	size_t nhp = 0U;
+	int rc = 0;
+
+	if (UNLIKELY(hds == NULL || hp == NULL)) {
+		rc = -1;
+		goto out;
+	}
+	/* build the heap of run heads */
+	for (size_t i = 0U; i < n; i++) {
+		if (run_next(hds + i, rs[i].fp) < 0) {
+			rc |= -ferror(rs[i].fp);
+			continue;
+		}
+		/* sift up */
+		size_t c = nhp++;
+		for (; c && head_lt_p(hds, i, hp[(c - 1U) / 2U]);
+		     c = (c - 1U) / 2U) {
+			hp[c] = hp[(c - 1U) / 2U];
+		}
+		hp[c] = i;
+	}
+	while (nhp) {
+		const size_t r = hp[0U];
+		size_t top;
+
+		if (out != NULL) {
+			const uint64_t hdr[2U] = {hds[r].h, hds[r].len};
+
+			fwrite(hdr, sizeof(hdr), 1U, out);
+			fwrite(hds[r].ln, 1, hds[r].len, out);
+		} else {
+			fwrite(hds[r].ln, 1, hds[r].len, stdout);
+		}
+		if (run_next(hds + r, rs[r].fp) < 0) {
+			rc |= -ferror(rs[r].fp);
+			top = hp[--nhp];
+		} else {
+			top = r;
+		}
+		/* sift down */
+		size_t p = 0U;
+		for (size_t c; (c = 2U * p + 1U) < nhp; p = c) {
+			if (c + 1U < nhp && head_lt_p(hds, hp[c + 1U], hp[c])) {
+				c++;
+			}
+			if (!head_lt_p(hds, hp[c], top)) {
+				break;
+			}
+			hp[p] = hp[c];
+		}
+		hp[p] = top;
+	}
+	if (UNLIKELY(rc < 0)) {
+		sort_err("read");
+	}
+out:
+	if (hds != NULL) {
+		for (size_t i = 0U; i < n; i++) {
+			free(hds[i].ln);
+		}
+	}
+	free(hds);
+	free(hp);
+	return rc;
+}
+
+static int
+run_fold(size_t r0)
+{
+/* merge run R0 and all runs after it into a single run */
+	FILE *fp;
+
+	if (UNLIKELY((fp = run_open()) == NULL)) {
+		return -1;
+	} else if (UNLIKELY(run_merge(fp, runs + r0, nruns - r0) < 0)) {
+		fclose(fp);
+		return -1;
+	} else if (UNLIKELY(run_close(fp) < 0)) {
+		return -1;
+	}
+	for (size_t i = r0; i < nruns; i++) {
+		fclose(runs[i].fp);
+	}
+	runs[r0] = (run_t){fp, runs[r0].lvl + 1U};
+	nruns = r0 + 1U;
+	return 0;
+}
+
+static int
+sort_spill(void)
+{
+	FILE *fp;
+
+	if (UNLIKELY((fp = run_open()) == NULL)) {
+		return -1;
+	}
+	qsort(recs, nrec, sizeof(*recs), srec_cmp);
+	for (size_t i = 0U; i < nrec; i++) {
+		const uint64_t hdr[2U] = {recs[i].h, recs[i].len};
+
+		fwrite(hdr, sizeof(hdr), 1U, fp);
+		fwrite(sbuf + recs[i].off, 1, recs[i].len, fp);
+	}
+	if (UNLIKELY(run_close(fp) < 0)) {
+		return -1;
+	}
+	runs[nruns++] = (run_t){fp, 0U};
+	nrec = 0U;
+	sbi = 0U;
+	/* levels never increase towards the end, so if the first and
+	 * the last of the final MERGE_FANIN runs agree, all of them do */
+	while (nruns >= MERGE_FANIN &&
+	       runs[nruns - MERGE_FANIN].lvl == runs[nruns - 1U].lvl) {
+		if (UNLIKELY(run_fold(nruns - MERGE_FANIN) < 0)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+sort_push(uint64_t h, const char *ln, size_t len)
+{
+	if (UNLIKELY(serr)) {
+		/* reported already */
+		return -1;
+	}
+	if (nrec && sbi + len + (nrec + 1U) * sizeof(*recs) > sortz &&
+	    UNLIKELY(sort_spill() < 0)) {
+		return -1;
+	}
+	if (UNLIKELY(nrec >= zrec)) {
+		const size_t nuz = (zrec * 2U) ?: 4096U;
+		srec_t *nu = realloc(recs, nuz * sizeof(*recs));
+
+		if (UNLIKELY(nu == NULL)) {
+			return -1;
+		}
+		recs = nu;
+		zrec = nuz;
+	}
+	if (UNLIKELY(sbi + len > sbz)) {
+		size_t nuz = (sbz * 2U) ?: 65536U;
+		char *nu;
+
+		for (; nuz < sbi + len; nuz *= 2U);
+		if (UNLIKELY((nu = realloc(sbuf, nuz)) == NULL)) {
+			return -1;
+		}
+		sbuf = nu;
+		sbz = nuz;
+	}
+	memcpy(sbuf + sbi, ln, len);
+	recs[nrec++] = (srec_t){h, sseq++, sbi, len};
+	sbi += len;
+	return 0;
+}
+
+static int
+sort_fin(void)
+{
+	int rc = 0;
+
+	if (UNLIKELY(serr)) {
+		rc = -1;
+	} else if (!nruns) {
+		/* everything fit into memory */
+		qsort(recs, nrec, sizeof(*recs), srec_cmp);
+		for (size_t i = 0U; i < nrec; i++) {
+			fwrite(sbuf + recs[i].off, 1, recs[i].len, stdout);
+		}
+	} else if (nrec && UNLIKELY(sort_spill() < 0)) {
+		rc = -1;
+	} else {
+		/* fold the youngest runs until one merge takes them all */
+		while (rc >= 0 && nruns > MERGE_FANIN) {
+			rc = run_fold(nruns - MERGE_FANIN);
+		}
+		if (LIKELY(rc >= 0)) {
+			rc = run_merge(NULL, runs, nruns);
+		}
+	}
+	for (size_t i = 0U; i < nruns; i++) {
+		fclose(runs[i].fp);
+	}
+	free(runs);
+	free(recs);
+	free(sbuf);
+	return rc;
+}
+
+
+static echs_idrng_t
+current_idrng(void)
+{
+	/* second precision ought to be good enough */
+	echs_idiff_t low = {
+		.dpart = now / 86400,
+		.intra = (now % 86400) * MSECS_PER_SEC,
+	};
+	return (echs_idrng_t){low, echs_max_idiff()};
+}
+
+/* range readers, ranges come relative to the epoch of dimension D,
+ * up to NR occurrences go into R, their number is returned,
+ * ON is NULL if nothing could be read */
+static bool epochms;
+static echs_range_t *rrng;
+static size_t zrrng;
+
+static size_t
+iso_strp(
+	echs_idrng_t *restrict r, size_t nr,
+	const char *s, char **on, size_t len, unsigned int d)
+{
+	size_t n = rrange_strp(rrng, zrrng, s, on, len);
+
+	if (UNLIKELY(n > zrrng)) {
+		/* repeating ranges, make room */
+		echs_range_t *nu = realloc(rrng, n * sizeof(*rrng));
+
+		if (UNLIKELY(nu == NULL)) {
+			*on = NULL;
+			return 0U;
+		}
+		rrng = nu;
+		zrrng = n;
+		n = rrange_strp(rrng, zrrng, s, on, len);
+	}
+	for (size_t i = 0U; i < n && i < nr; i++) {
+		if (d == 1U && echs_nul_instant_p(rrng[i].beg)) {
+			r[i] = current_idrng();
+			continue;
+		}
+		r[i] = echs_range_diff(rrng[i], bmap.epoch[d]);
+	}
+	return n;
+}
+
+static size_t
+epoch_strp(
+	echs_idrng_t *restrict r, size_t nr,
+	const char *s, char **on, size_t len, unsigned int d)
+{
+/* Unix epoch numbers are off the epoch by a constant, no calendar */
+	int64_t ms[2U];
+
+	if (UNLIKELY(epoch_range_strp(ms, s, on, len, epochms) < 0)) {
+		return 0U;
+	} else if (nr) {
+		*r = echs_unixms_idrng(ms, d);
+	}
+	return 1U;
+}
+
+static size_t(*rstrp)(
+	echs_idrng_t*, size_t, const char*, char**, size_t, unsigned int) =
+	iso_strp;
+
+
+/* output formats, they get the boxes of one line,
+ * z coordinates of tri-temporal lines come in PZ, two per box */
+static const double *pz;
+/* record numbers of the boxes, if non-NULL, pieces of one record
+ * go into a collection of their own */
+static const size_t *prec;
+
+static void
+prnt_wkt(const echs_box_t *b, size_t nb, bool collp)
+{
+	char buf[384U];
+
+	if (collp) {
+		obuf_add("GEOMETRYCOLLECTION(", strlenof("GEOMETRYCOLLECTION("));
+	}
+	for (size_t i = 0U; i < nb; i++) {
+		size_t z = 0U;
+
+		if (i) {
+			buf[z++] = ',';
+			buf[z++] = ' ';
+		}
+		if (prec != NULL && (!i || prec[i - 1U] != prec[i]) &&
+		    i + 1U < nb && prec[i + 1U] == prec[i]) {
+			memcpy(buf + z, "GEOMETRYCOLLECTION(",
+			       strlenof("GEOMETRYCOLLECTION("));
+			z += strlenof("GEOMETRYCOLLECTION(");
+		}
+		if (pz == NULL) {
+			z += box_strf(buf + z, sizeof(buf) - z, b[i]);
+		} else {
+			z += box3_strf(buf + z, sizeof(buf) - z, b[i], pz + 2U * i);
+		}
+		if (prec != NULL && i && prec[i - 1U] == prec[i] &&
+		    (i + 1U >= nb || prec[i + 1U] != prec[i])) {
+			buf[z++] = ')';
+		}
+		obuf_add(buf, z);
+	}
+	if (collp) {
+		obuf_addc(')');
+	}
+	return;
+}
+
+static unsigned int zbits = 16U;
+static uint64_t zlo;
+static uint64_t zhi;
+static bool zpend;
+/* at most MAXRNGS ranges per box, NZRNG so far */
+static size_t maxrngs = 64U;
+static size_t nzrng;
+
+static void
+zrng_flush(void)
+{
+	char buf[48U];
+	const int w = (2U * zbits + 3U) / 4U;
+	int z;
+
+	if (!zpend) {
+		return;
+	}
+	z = snprintf(buf, sizeof(buf), "%0*llx-%0*llx",
+		     w, (unsigned long long int)zlo,
+		     w, (unsigned long long int)zhi);
+	obuf_add(buf, z);
+	zpend = false;
+	return;
+}
+
+static void
+zrng_add(uint64_t lo, uint64_t hi)
+{
+	if (zpend && lo == zhi + 1U) {
+		/* contiguous, extend pending range */
+		zhi = hi;
+		return;
+	} else if (zpend) {
+		zrng_flush();
+		obuf_addc(',');
+	}
+	zlo = lo;
+	zhi = hi;
+	zpend = true;
+	nzrng++;
+	return;
+}
+
+static void
+zrng_cover(const uint32_t lo[static 2U], const uint32_t hi[static 2U],
+	   uint32_t nx, uint32_t ny, unsigned int lvl)
+{
+/* quadtree descent in Z order, node (NX, NY) on level LVL spans the
+ * cells NX << LVL up to ((NX + 1) << LVL) - 1 */
+	const uint64_t x0 = (uint64_t)nx << lvl;
+	const uint64_t y0 = (uint64_t)ny << lvl;
+	const uint64_t x1 = x0 + ((uint64_t)1U << lvl) - 1U;
+	const uint64_t y1 = y0 + ((uint64_t)1U << lvl) - 1U;
+
+	if (x1 < lo[0U] || x0 > hi[0U] || y1 < lo[1U] || y0 > hi[1U]) {
+		/* disjoint */
+		return;
+	} else if (nzrng > maxrngs) {
+		/* too many already, the caller coarsens */
+		return;
+	} else if (lo[0U] <= x0 && x1 <= hi[0U] &&
+		   lo[1U] <= y0 && y1 <= hi[1U]) {
+		/* fully covered */
+		const uint64_t z = echs_morton(x0, y0);
+		zrng_add(z, z + ((lvl < 32U
+				  ? (uint64_t)1U << (2U * lvl)
+				  : 0U) - 1U));
+		return;
+	}
+	/* children in Z order */
+	lvl--;
+	zrng_cover(lo, hi, 2U * nx + 0U, 2U * ny + 0U, lvl);
+	zrng_cover(lo, hi, 2U * nx + 1U, 2U * ny + 0U, lvl);
+	zrng_cover(lo, hi, 2U * nx + 0U, 2U * ny + 1U, lvl);
+	zrng_cover(lo, hi, 2U * nx + 1U, 2U * ny + 1U, lvl);
+	return;
+}
+
+
+/* coverings, cells of the quadtree over the zorder grid, a cell on
+ * level L has coordinates X, Y < 2^L and S2-style id
+ * (morton(X, Y) << 1 | 1) << 2 * (31 - L) */
+typedef struct {
+	uint32_t x;
+	uint32_t y;
+	unsigned int lvl;
+	/* cell area not covered by the box, in finest cells */
+	double waste;
+} cell_t;
+
+static size_t maxcells = 8U;
+static cell_t *cells;
+static size_t zcells;
+
+static double
+cell_waste(cell_t c, const uint32_t lo[static 2U], const uint32_t hi[static 2U])
+{
+	const unsigned int sh = zbits - c.lvl;
+	const double x0 = (double)((uint64_t)c.x << sh);
+	const double y0 = (double)((uint64_t)c.y << sh);
+	const double w = ldexp(1, sh);
+	const double ix = fmin(x0 + w, (double)hi[0U] + 1) - fmax(x0, lo[0U]);
+	const double iy = fmin(y0 + w, (double)hi[1U] + 1) - fmax(y0, lo[1U]);
+
+	if (ix <= 0 || iy <= 0) {
+		/* disjoint, not an option */
+		return -1;
+	}
+	return w * w - ix * iy;
+}
+
+static inline uint64_t
+cell_id(cell_t c)
+{
+	return (echs_morton(c.x, c.y) << 1U | 1U) << (2U * (31U - c.lvl));
+}
+
+static inline uint64_t
+cell_zlo(cell_t c)
+{
+/* the first Morton key in C */
+	const unsigned int sh = zbits - c.lvl;
+	return echs_morton((uint32_t)((uint64_t)c.x << sh),
+			   (uint32_t)((uint64_t)c.y << sh));
+}
+
+static int
+cell_cmp(const void *a, const void *b)
+{
+/* cells are disjoint, so this is the order of their ids */
+	const uint64_t x = cell_zlo(*(const cell_t*)a);
+	const uint64_t y = cell_zlo(*(const cell_t*)b);
+	return (x > y) - (x < y);
+}
+
+static size_t
+cover(const uint32_t lo[static 2U], const uint32_t hi[static 2U])
+{
+/* greedy: start with the smallest cell containing the box, then keep
+ * splitting the cell that wastes most as long as its intersecting
+ * children fit into MAXCELLS */
+	size_t ncells = 0U;
+	/* split candidates, a max-heap on waste, indices into CELLS */
+	size_t *hp;
+	size_t nhp = 0U;
+
+	if (UNLIKELY(zcells < maxcells + 3U)) {
+		cell_t *nu = realloc(cells, (maxcells + 3U) * sizeof(*cells));
+
+		if (UNLIKELY(nu == NULL)) {
+			return 0U;
+		}
+		cells = nu;
+		zcells = maxcells + 3U;
+	}
+	if (UNLIKELY((hp = malloc(zcells * sizeof(*hp))) == NULL)) {
+		return 0U;
+	}
+
+	with (unsigned int d = 0U) {
+		for (; (uint64_t)(lo[0U] ^ hi[0U]) >> d ||
+			     (uint64_t)(lo[1U] ^ hi[1U]) >> d; d++);
+		cells[0U] = (cell_t){
+			(uint32_t)((uint64_t)lo[0U] >> d),
+			(uint32_t)((uint64_t)lo[1U] >> d), zbits - d, 0};
+		cells[0U].waste = cell_waste(cells[0U], lo, hi);
+		ncells = 1U;
+	}
+
+#define HP_LT(i, j)	(cells[hp[i]].waste < cells[hp[j]].waste)
+#define HP_SWAP(i, j)	do {			\
+		size_t t = hp[i];		\
+		hp[i] = hp[j];			\
+		hp[j] = t;			\
+	} while (0)
+#define HP_PUSH(c)	do {				\
+		size_t k = nhp++;			\
+		hp[k] = (c);				\
+		for (; k && HP_LT((k - 1U) / 2U, k);	\
+		     k = (k - 1U) / 2U) {		\
+			HP_SWAP(k, (k - 1U) / 2U);	\
+		}					\
+	} while (0)
+
+	if (cells[0U].waste > 0 && cells[0U].lvl < zbits) {
+		HP_PUSH(0U);
+	}
+	while (nhp) {
+		const size_t top = hp[0U];
+		const cell_t c = cells[top];
+		cell_t kids[4U];
+		size_t nkids = 0U;
+
+		/* pop */
+		hp[0U] = hp[--nhp];
+		for (size_t k = 0U, m; (m = 2U * k + 1U) < nhp; k = m) {
+			if (m + 1U < nhp && HP_LT(m, m + 1U)) {
+				m++;
+			}
+			if (!HP_LT(k, m)) {
+				break;
+			}
+			HP_SWAP(k, m);
+		}
+
+		for (unsigned int q = 0U; q < 4U; q++) {
+			cell_t k = {
+				2U * c.x + (q & 1U), 2U * c.y + (q >> 1U),
+				c.lvl + 1U, 0,
+			};
+
+			if ((k.waste = cell_waste(k, lo, hi)) >= 0) {
+				kids[nkids++] = k;
+			}
+		}
+		if (ncells - 1U + nkids > maxcells) {
+			/* too many, C stays as is */
+			continue;
+		}
+		/* replace C by its kids */
+		for (size_t i = 0U; i < nkids; i++) {
+			const size_t j = i ? ncells++ : top;
+
+			cells[j] = kids[i];
+			if (kids[i].waste > 0 && kids[i].lvl < zbits) {
+				HP_PUSH(j);
+			}
+		}
+	}
+#undef HP_LT
+#undef HP_SWAP
+#undef HP_PUSH
+	free(hp);
+	qsort(cells, ncells, sizeof(*cells), cell_cmp);
+	return ncells;
+}
+
+static void
+prnt_zorder(const echs_box_t *b, size_t nb, bool UNUSED(collp))
+{
+	for (size_t i = 0U; i < nb; i++) {
+		const size_t ob0 = obi;
+		uint32_t lo[2U], hi[2U];
+
+		if (i) {
+			obuf_addc(';');
+			obuf_addc(' ');
+		}
+		echs_box_cells(lo, hi, b[i], zbits);
+		nzrng = 0U;
+		zrng_cover(lo, hi, 0U, 0U, zbits);
+		if (nzrng > maxrngs) {
+			/* coarsen, ranges of a covering by at most MAXRNGS
+			 * cells, some keys outside the box are included */
+			const size_t k = maxcells;
+			size_t nc;
+
+			obi = ob0 + 2U * !!i;
+			zpend = false;
+			maxcells = maxrngs;
+			nc = cover(lo, hi);
+			maxcells = k;
+			for (size_t j = 0U; j < nc; j++) {
+				const unsigned int sh = zbits - cells[j].lvl;
+				const uint64_t z = cell_zlo(cells[j]);
+
+				zrng_add(z, z + ((sh < 32U
+						  ? (uint64_t)1U << 2U * sh
+						  : 0U) - 1U));
+			}
+		}
+		zrng_flush();
+	}
+	return;
+}
+
+static void
+prnt_cover(const echs_box_t *b, size_t nb, bool UNUSED(collp))
+{
+	for (size_t i = 0U; i < nb; i++) {
+		uint32_t lo[2U], hi[2U];
+		size_t nc;
+
+		if (i) {
+			obuf_addc(';');
+			obuf_addc(' ');
+		}
+		echs_box_cells(lo, hi, b[i], zbits);
+		nc = cover(lo, hi);
+		for (size_t j = 0U; j < nc; j++) {
+			char buf[24U];
+			int z;
+
+			/* tokens, trailing zeros stripped */
+			z = snprintf(buf + 1U, sizeof(buf) - 1U, "%016llx",
+				     (unsigned long long int)cell_id(cells[j]));
+			for (; z > 1 && buf[z] == '0'; z--);
+			buf[0U] = ',';
+			obuf_add(buf + !j, z + !!j);
+		}
+	}
+	return;
+}
+
+
+/* RDF statements, subject, predicate and graph come from the prefix
+ * columns, the object is the line's WKT */
+#define GEO_ASWKT	"<http://www.opengis.net/ont/geosparql#asWKT>"
+#define GEO_WKTLITERAL	"<http://www.opengis.net/ont/geosparql#wktLiteral>"
+
+static enum {
+	RDF_NONE,
+	RDF_NT,
+	RDF_NQ,
+} rdf;
+static const char *rdfg;
+
+/* prefixed names P:NAME expand through --prefix P=IRI */
+static char *const *rdfp;
+static size_t nrdfp;
+
+static size_t
+rdf_scheme(const char *s, size_t n)
+{
+/* return the length of the scheme S starts with, or 0 */
+	size_t i = 1U;
+
+	if (!n || !isalpha(*s)) {
+		return 0U;
+	}
+	for (; i < n && (isalnum(s[i]) || memchr("+-.", s[i], 3U)); i++);
+	return i < n && s[i] == ':' ? i : 0U;
+}
+
+static const char*
+rdf_iri(const char **s, size_t *n)
+{
+/* turn term S of length N into an IRI, strip angle brackets or the
+ * prefix of a prefixed name, return the expansion of the prefix,
+ * "" if there's none, or NULL if S is no absolute IRI */
+	const char *c;
+	size_t k;
+
+	if (*n >= 2U && **s == '<' && (*s)[*n - 1U] == '>') {
+		/* anything absolute goes, e.g. <urn:x:y> */
+		*s += 1U, *n -= 2U;
+		return rdf_scheme(*s, *n) ? "" : NULL;
+	} else if ((c = memchr(*s, ':', *n)) != NULL) {
+		const size_t np = c - *s;
+
+		for (size_t i = 0U; i < nrdfp; i++) {
+			if (!strncmp(rdfp[i], *s, np) && rdfp[i][np] == '=') {
+				*s += np + 1U, *n -= np + 1U;
+				return rdfp[i] + np + 1U;
+			}
+		}
+	}
+	/* bare IRIs need an authority, the rest are prefixed names */
+	k = rdf_scheme(*s, *n);
+	return k && k + 2U < *n && (*s)[k + 1U] == '/' && (*s)[k + 2U] == '/'
+		? "" : NULL;
+}
+
+static void
+rdf_pct(const char *s, size_t n)
+{
+/* percent-encode what IRIREFs don't allow */
+	for (size_t i = 0U, j; i < n; i = j + 1U) {
+		char u[4U];
+
+		for (j = i; j < n && (unsigned char)s[j] > ' ' &&
+			     !memchr("<>\"{}|^`\\", s[j], 9U); j++);
+		obuf_add(s + i, j - i);
+		if (j < n) {
+			snprintf(u, sizeof(u), "%%%02X", (unsigned char)s[j]);
+			obuf_add(u, 3U);
+		}
+	}
+	return;
+}
+
+static int
+rdf_term(const char *s, size_t n)
+{
+	const char *const s0 = s;
+	const size_t n0 = n;
+	const char *x;
+
+	/* blank nodes go verbatim, anything else is an IRI */
+	if (n > 2U && s[0U] == '_' && s[1U] == ':') {
+		obuf_add(s, n);
+		return 0;
+	} else if (UNLIKELY((x = rdf_iri(&s, &n)) == NULL)) {
+		fprintf(stderr, "\
+Error: `%.*s' is neither an absolute IRI nor a known prefixed name\n",
+			(int)n0, s0);
+		return -1;
+	}
+	obuf_addc('<');
+	rdf_pct(x, strlen(x));
+	rdf_pct(s, n);
+	obuf_addc('>');
+	return 0;
+}
+
+static size_t
+rdf_cols(const char *col[static 3U], size_t ncol[static 3U],
+	 const char *pre, size_t len)
+{
+/* split PRE into at most 3 tab-separated columns, return their number */
+	const char *const ep = pre + len;
+	size_t n = 0U;
+
+	for (const char *sp = pre; n < 3U && sp < ep; n++) {
+		const char *tp = memchr(sp, '\t', ep - sp) ?: ep;
+
+		col[n] = sp;
+		ncol[n] = tp - sp;
+		sp = tp + 1U;
+	}
+	return n;
+}
+
+static int
+rdf_beg(const char *const col[static 3U], const size_t ncol[static 3U],
+	size_t n)
+{
+	if (UNLIKELY(rdf_term(col[0U], ncol[0U]) < 0)) {
+		return -1;
+	}
+	obuf_addc(' ');
+	if (n > 1U && ncol[1U]) {
+		if (UNLIKELY(rdf_term(col[1U], ncol[1U]) < 0)) {
+			return -1;
+		}
+	} else {
+		obuf_add(GEO_ASWKT, strlenof(GEO_ASWKT));
+	}
+	obuf_addc(' ');
+	obuf_addc('"');
+	return 0;
+}
+
+static int
+rdf_end(const char *const col[static 3U], const size_t ncol[static 3U],
+	size_t n)
+{
+	/* our WKT has nothing to escape */
+	obuf_add("\"^^" GEO_WKTLITERAL, strlenof("\"^^" GEO_WKTLITERAL));
+	if (rdf == RDF_NQ && n > 2U && ncol[2U]) {
+		obuf_addc(' ');
+		if (UNLIKELY(rdf_term(col[2U], ncol[2U]) < 0)) {
+			return -1;
+		}
+	} else if (rdf == RDF_NQ && rdfg != NULL) {
+		obuf_addc(' ');
+		if (UNLIKELY(rdf_term(rdfg, strlen(rdfg)) < 0)) {
+			return -1;
+		}
+	}
+	obuf_addc(' ');
+	obuf_addc('.');
+	return 0;
+}
+
+
+
+/* PGCOPY binary tuples, key columns as text fields, geometries as
+ * (little-endian) EWKB polygons or collections thereof, z is ignored */
+#define PGCOPY_SIG	"PGCOPY\n\377\r\n"
+#define EWKB_SRID	0x20000000U
+#define EWKB_POLYZ	(1U + 4U + 4U + 4U + 5U * 16U)
+
+static bool pgcp;
+static uint32_t srid;
+
+static inline void
+obuf_be16(uint16_t x)
+{
+	x = htobe16(x);
+	obuf_add((const void*)&x, sizeof(x));
+	return;
+}
+
+static inline void
+obuf_be32(uint32_t x)
+{
+	x = htobe32(x);
+	obuf_add((const void*)&x, sizeof(x));
+	return;
+}
+
+static inline void
+obuf_le32(uint32_t x)
+{
+	x = htole32(x);
+	obuf_add((const void*)&x, sizeof(x));
+	return;
+}
+
+static inline void
+obuf_ledbl(double d)
+{
+	uint64_t x;
+
+	memcpy(&x, &d, sizeof(x));
+	x = htole64(x);
+	obuf_add((const void*)&x, sizeof(x));
+	return;
+}
+
+static void
+ewkb_poly(echs_box_t b, bool sridp)
+{
+	static const unsigned int cx[] = {0U, 1U, 1U, 0U, 0U};
+	static const unsigned int cy[] = {0U, 0U, 1U, 1U, 0U};
+	const double x[2U] = {b.from[0U], b.to[0U]};
+	const double y[2U] = {b.from[1U], b.to[1U]};
+
+	obuf_addc('\001');
+	obuf_le32(3U | (sridp ? EWKB_SRID : 0U));
+	if (sridp) {
+		obuf_le32(srid);
+	}
+	/* one ring of 5 points */
+	obuf_le32(1U);
+	obuf_le32(5U);
+	for (size_t i = 0U; i < countof(cx); i++) {
+		obuf_ledbl(x[cx[i]]);
+		obuf_ledbl(y[cy[i]]);
+	}
+	return;
+}
+
+static void
+prnt_ewkb(const echs_box_t *b, size_t nb, bool collp)
+{
+	/* a field of its own, length first, NULL for no boxes */
+	const size_t sz = 4U * (srid > 0U) +
+		(collp ? 1U + 4U + 4U + nb * EWKB_POLYZ : EWKB_POLYZ);
+
+	if (UNLIKELY(!nb)) {
+		obuf_be32(-1);
+		return;
+	}
+	obuf_be32(sz);
+	if (!collp) {
+		ewkb_poly(*b, srid > 0U);
+		return;
+	}
+	obuf_addc('\001');
+	obuf_le32(7U | (srid ? EWKB_SRID : 0U));
+	if (srid) {
+		obuf_le32(srid);
+	}
+	obuf_le32(nb);
+	for (size_t i = 0U; i < nb; i++) {
+		ewkb_poly(b[i], false);
+	}
+	return;
+}
+
+static void
+pg_beg(const char *pre, size_t len, size_t ngeo)
+{
+/* PRE is the prefix including its final tab, every column a field */
+	const char *const ep = pre + len;
+	size_t nf = ngeo;
+
+	for (const char *tp = pre; (tp = memchr(tp, '\t', ep - tp)); tp++) {
+		nf++;
+	}
+	obuf_be16(nf);
+	for (const char *sp = pre, *tp; sp < ep; sp = tp + 1U) {
+		tp = memchr(sp, '\t', ep - sp);
+		obuf_be32(tp - sp);
+		obuf_add(sp, tp - sp);
+	}
+	return;
+}
+
+
+
+/* GeoJSON FeatureCollection, one feature per line, prefix columns
+ * become properties and boxes polygons, z is ignored */
+static bool gjsn;
+static size_t ngj;
+/* property names, comma-separated */
+static const char *gjnames;
+
+static void
+json_str(const char *s, size_t n)
+{
+	obuf_addc('"');
+	for (size_t i = 0U, j; i < n; i = j + 1U) {
+		char u[8U];
+
+		for (j = i; j < n && (unsigned char)s[j] >= ' ' &&
+			     s[j] != '"' && s[j] != '\\'; j++);
+		obuf_add(s + i, j - i);
+		if (j >= n) {
+			break;
+		} else if (s[j] == '"' || s[j] == '\\') {
+			obuf_addc('\\');
+			obuf_addc(s[j]);
+		} else {
+			snprintf(u, sizeof(u), "\\u%04x", (unsigned char)s[j]);
+			obuf_add(u, 6U);
+		}
+	}
+	obuf_addc('"');
+	return;
+}
+
+static void
+gj_name(size_t i)
+{
+/* name of prefix column I, from --properties or key, key2, ... */
+	const char *s = gjnames;
 
-#define MAX_GEOFLT	(90. * 128.)
-#define MIN_GEOFLT	(-MAX_GEOFLT)
+	for (size_t k = 0U; s != NULL && k < i; k++) {
+		if ((s = strchr(s, ',')) != NULL) {
+			s++;
+		}
+	}
+	if (s != NULL) {
+		json_str(s, strchrnul(s, ',') - s);
+	} else if (!i) {
+		obuf_add("\"key\"", strlenof("\"key\""));
+	} else {
+		char buf[32U];
 
-
-/* time and geo magic */
-static inline __attribute__((const, pure)) double
-idiff2geoflt(echs_idiff_t x)
-{
-	double r = (double)x.dpart + (double)x.intra / (double)MSECS_PER_DAY;
-	return r >= MAX_GEOFLT
-		? MAX_GEOFLT
-		: r <= MIN_GEOFLT
-		? MIN_GEOFLT
-		: r;
+		obuf_add(buf, snprintf(buf, sizeof(buf), "\"key%zu\"", i + 1U));
+	}
+	obuf_addc(':');
+	return;
 }
 
-static echs_idrng_t
-current_idrng(void)
+static void
+gj_beg(const char *pre, size_t len)
 {
-	/* second precision ought to be good enough */
-	echs_idiff_t low = {
-		.dpart = now / 86400,
-		.intra = (now % 86400) * MSECS_PER_SEC,
-	};
-	return (echs_idrng_t){low, echs_max_idiff()};
+/* PRE is the prefix including its final tab, every column a property */
+	static const char feat[] = "{\"type\":\"Feature\",\"properties\":{";
+	const char *const ep = pre + len;
+	size_t i = 0U;
+
+	if (ngj++) {
+		obuf_add(",\n", 2U);
+	}
+	obuf_add(feat, strlenof(feat));
+	for (const char *sp = pre, *tp; sp < ep; sp = tp + 1U, i++) {
+		tp = memchr(sp, '\t', ep - sp);
+		if (i) {
+			obuf_addc(',');
+		}
+		gj_name(i);
+		json_str(sp, tp - sp);
+	}
+	obuf_add("},", 2U);
+	return;
 }
 
 static void
-t2geo(echs_range_t valid, echs_range_t systm)
+prnt_geojson(const echs_box_t *b, size_t nb, bool collp)
 {
-	echs_idrng_t v = echs_range_diff(valid, reftm);
-	echs_idrng_t s = echs_nul_instant_p(systm.beg)
-		? current_idrng() : echs_range_diff(systm, reftm);
-	double from[2U], to[2U];
+	char buf[384U];
+	echs_box_t env;
+	size_t z;
 
-	from[0U] = idiff2geoflt(v.lower);
-	to[0U] = idiff2geoflt(v.upper);
-	from[1U] = idiff2geoflt(s.lower);
-	to[1U] = !echs_max_idiff_p(s.upper)
-		? idiff2geoflt(s.upper) : MAX_GEOFLT;
-
-#if 1
-	from[0U] = scalbn(from[0U], -7);
-	from[1U] = scalbn(from[1U], -7);
-	to[0U] = scalbn(to[0U], -7);
-	to[1U] = scalbn(to[1U], -7);
-#else
-	from[0U] /= 100.;
-	from[1U] /= 100.;
-	to[0U] /= 100.;
-	to[1U] /= 100.;
-#endif
+	if (UNLIKELY(!nb)) {
+		obuf_add("\"geometry\":null}", strlenof("\"geometry\":null}"));
+		return;
+	}
+	env = b[0U];
+	for (size_t i = 1U; i < nb; i++) {
+		env = echs_box_union(env, b[i]);
+	}
+	z = snprintf(buf, sizeof(buf), "\
+\"bbox\":[%.17f,%.17f,%.17f,%.17f],\
+\"geometry\":{\"type\":\"%s\",\"coordinates\":%s",
+		     env.from[0U], env.from[1U], env.to[0U], env.to[1U],
+		     collp ? "MultiPolygon" : "Polygon", collp ? "[" : "");
+	obuf_add(buf, z);
+	for (size_t i = 0U; i < nb; i++) {
+		/* exterior rings counterclockwise */
+		const double x[2U] = {b[i].from[0U], b[i].to[0U]};
+		const double y[2U] = {b[i].from[1U], b[i].to[1U]};
 
-	fprintf(stdout, "BOX(%.17f %.17f, %.17f %.17f)",
-		from[0U], from[1U], to[0U], to[1U]);
+		z = snprintf(buf, sizeof(buf), "%s[[\
+[%.17f,%.17f],[%.17f,%.17f],[%.17f,%.17f],[%.17f,%.17f],[%.17f,%.17f]]]",
+			     i ? "," : "",
+			     x[0U], y[0U], x[1U], y[0U], x[1U], y[1U],
+			     x[0U], y[1U], x[0U], y[0U]);
+		obuf_add(buf, z);
+	}
+	obuf_add("]}}" + !collp, 2U + collp);
 	return;
 }
 
+
 
+/* Arrow IPC stream, one row per box, the prefix as key column,
+ * the line's ranges as timestamps and the boxes' coordinates,
+ * z is ignored */
+static bool arrp;
+static size_t arrz = BOXARROW_BATCHZ;
+static const char *akey;
+static size_t nakey;
+/* exact ranges of the boxes, as milliseconds, four per box */
+static const int64_t *pms;
+
+static void
+prnt_arrow(const echs_box_t *b, size_t nb, bool UNUSED(collp))
+{
+	for (size_t i = 0U; i < nb; i++) {
+		if (UNLIKELY(boxarrow_push(obuf_add, arrz, akey, nakey,
+					   b[i], pms + 4U * i) < 0)) {
+			oberr = -1;
+			return;
+		}
+	}
+	return;
+}
+
+
+static echs_box_t *lbox;
+/* z coordinates of the boxes in LBOX and of the current box */
+static double *lz;
+static double curz[2U];
+/* ranges of the boxes in LBOX and of the current box, milliseconds */
+static int64_t *lms;
+static int64_t curms[4U];
+/* records of the boxes in LBOX, i.e. the index of their first box */
+static size_t *lrec;
+static size_t currec;
+static size_t zlbox;
+static void(*prnt)(const echs_box_t*, size_t, bool) = prnt_wkt;
+/* slab widths in geo units, or 0 for no splitting */
+static double slabg[2U];
+static size_t maxslabs = 64U;
+static double *cuts[2U];
+/* simplify collections beyond this many boxes, or 0 for never */
+static size_t simk;
+static echs_box_t *sbox;
+static double *sz;
+static size_t zsbox;
+/* convert picked columns, lines have no prefix then */
+static cols_t cols[1U] = {{.sep = '\t'}};
+static bool colp;
+/* valid ranges of one item, more than one if repeating */
+static echs_idrng_t *vrng;
+static size_t zvrng;
+
+static int
+lbox_push(size_t *nbox, echs_box_t b)
+{
+	if (UNLIKELY(*nbox >= zlbox)) {
+		const size_t nuz = (zlbox * 2U) ?: 64U;
+		echs_box_t *nu = realloc(lbox, nuz * sizeof(*lbox));
+		double *nz = realloc(lz, 2U * nuz * sizeof(*lz));
+		int64_t *nm = realloc(lms, 4U * nuz * sizeof(*lms));
+		size_t *nr = realloc(lrec, nuz * sizeof(*lrec));
+
+		if (nu != NULL) {
+			lbox = nu;
+		}
+		if (nz != NULL) {
+			lz = nz;
+		}
+		if (nm != NULL) {
+			lms = nm;
+		}
+		if (nr != NULL) {
+			lrec = nr;
+		}
+		if (UNLIKELY(nu == NULL || nz == NULL || nm == NULL ||
+			     nr == NULL)) {
+			return -1;
+		}
+		zlbox = nuz;
+	}
+	lz[2U * *nbox + 0U] = curz[0U];
+	lz[2U * *nbox + 1U] = curz[1U];
+	memcpy(lms + 4U * *nbox, curms, sizeof(curms));
+	lrec[*nbox] = currec;
+	lbox[(*nbox)++] = b;
+	return 0;
+}
+
+static inline double
+slab_next(double v, double w)
+{
+	double c = (floor(v / w) + 1) * w;
+
+	if (UNLIKELY(c <= v)) {
+		/* V was a boundary but didn't divide evenly */
+		c = (floor(v / w) + 2) * w;
+	}
+	return c;
+}
+
+static inline double
+slab_prev(double v, double w)
+{
+	double c = (ceil(v / w) - 1) * w;
+
+	if (UNLIKELY(c >= v)) {
+		c = (ceil(v / w) - 2) * w;
+	}
+	return c;
+}
+
+static size_t
+slab_cuts(double *restrict cut, double from, double to, double w)
+{
+/* cut a half-open dimension at slab boundaries starting at its finite
+ * end, the last piece spans the rest up to the clamp */
+	size_t n = 0U;
+
+	if (from <= MIN_GEOFLT && to >= MAX_GEOFLT) {
+		/* every query hits this one, nothing to gain */
+		;
+	} else if (to >= MAX_GEOFLT) {
+		for (double c = slab_next(from, w);
+		     c < to && n + 1U < maxslabs; c = slab_next(c, w)) {
+			cut[n++] = c;
+		}
+	} else if (from <= MIN_GEOFLT) {
+		for (double c = slab_prev(to, w);
+		     c > from && n + 1U < maxslabs; c = slab_prev(c, w)) {
+			cut[n++] = c;
+		}
+		for (size_t i = 0U, j = n; i + 1U < j; i++, j--) {
+			const double t = cut[i];
+			cut[i] = cut[j - 1U];
+			cut[j - 1U] = t;
+		}
+	}
+	return n;
+}
+
+static int
+slab_push(size_t *nbox, echs_box_t b)
+{
+/* split dimensions that run into the clamps at slab boundaries,
+ * i.e. multiples of the slab width off the reference instant */
+	size_t ncut[2U];
+
+	if (!(slabg[0U] > 0)) {
+		return lbox_push(nbox, b);
+	}
+	for (size_t d = 0U; d < 2U; d++) {
+		ncut[d] = slab_cuts(cuts[d] + 1U, b.from[d], b.to[d], slabg[d]);
+		cuts[d][0U] = b.from[d];
+		cuts[d][ncut[d] + 1U] = b.to[d];
+	}
+	for (size_t i = 0U; i <= ncut[0U]; i++) {
+		for (size_t j = 0U; j <= ncut[1U]; j++) {
+			const echs_box_t p = {
+				{cuts[0U][i], cuts[1U][j]},
+				{cuts[0U][i + 1U], cuts[1U][j + 1U]},
+			};
+
+			if (UNLIKELY(lbox_push(nbox, p) < 0)) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
 static int
 t2geo_ln(const char *wkt, size_t len)
 {
-	echs_range_t val;
-	echs_range_t sys;
+	size_t nv;
+	echs_idrng_t sys;
+	echs_idrng_t dec;
 	size_t wi = 0U;
 	size_t coll = 0U;
+	const size_t ob0 = obi;
+	size_t nbox = 0U;
+	bool trip = false;
 	int rc = 0;
+	const char *col[3U];
+	size_t ncol[3U];
+	size_t nc = 0U;
 
 	/* allow prefixes */
-	with (const char *wp = memchr(wkt, '\t', len)) {
+	if (rdf) {
+		/* prefix columns make the statement, ranges come last */
+		const char *wp = memrchr(wkt, '\t', len);
+
+		if (UNLIKELY(wp == NULL ||
+			     !(nc = rdf_cols(col, ncol, wkt, wp - wkt)) ||
+			     !ncol[0U])) {
+			fprintf(stderr, "\
+Error: no subject in line `%.*s'\n", (int)len, wkt);
+			return -1;
+		}
+		wi = ++wp - wkt;
+		if (UNLIKELY(rdf_beg(col, ncol, nc) < 0)) {
+			obi = ob0;
+			return -1;
+		}
+	} else if (pgcp) {
+		/* key columns become fields, ranges come last */
+		const char *wp = memrchr(wkt, '\t', len);
+
+		if (wp != NULL) {
+			wi = ++wp - wkt;
+		}
+		/* coverings get a column of their own */
+		pg_beg(wkt, wi, 1U + (simk > 0U));
+	} else if (gjsn) {
+		/* key columns become properties, ranges come last */
+		const char *wp = memrchr(wkt, '\t', len);
+
+		if (wp != NULL) {
+			wi = ++wp - wkt;
+		}
+		gj_beg(wkt, wi);
+	} else if (colp) {
+		/* the field is all ranges */
+		;
+	} else if (arrp) {
+		/* the prefix is the key column, ranges come last */
+		const char *wp = memrchr(wkt, '\t', len);
+
+		akey = NULL;
+		if (wp == NULL) {
+			;
+		} else if (UNLIKELY(memchr(wkt, '\t', wp - wkt) != NULL)) {
+			fprintf(stderr, "\
+Error: more than one key column in line `%.*s'\n", (int)len, wkt);
+			return -1;
+		} else {
+			akey = wkt;
+			nakey = wp - wkt;
+			wi = ++wp - wkt;
+		}
+	} else with (const char *wp = memchr(wkt, '\t', len)) {
 		if (wp != NULL) {
 			wi += ++wp - wkt;
-			fwrite(wkt, 1, wi, stdout);
+			obuf_add(wkt, wi);
 		}
 	}
 
@@ -139,15 +1490,29 @@ t2geo_ln(const char *wkt, size_t len)
 		char *eo;
 
 		for (; wi < len && isspace(wkt[wi]); wi++);
-		val = range_strp(wkt + wi, &eo, len - wi);
+		nv = rstrp(vrng, zvrng, wkt + wi, &eo, len - wi, 0U);
 		if (UNLIKELY(eo == NULL)) {
 			break;
+		} else if (UNLIKELY(nv > zvrng)) {
+			echs_idrng_t *nu = realloc(vrng, nv * sizeof(*vrng));
+
+			if (UNLIKELY(nu == NULL)) {
+				rc = -1;
+				break;
+			}
+			vrng = nu;
+			zvrng = nv;
+			nv = rstrp(vrng, zvrng, wkt + wi, &eo, len - wi, 0U);
 		}
+		/* repeating ones make a collection */
+		coll += nv > 1U;
 		/* reset WI */
 		wi = eo - wkt;
 		/* should be sep'd by comma */
+		dec = (echs_idrng_t){echs_min_idiff(), echs_max_idiff()};
 		if (wi >= len || wkt[wi++] != ',') {
-			sys = echs_max_range();
+			/* known from now on */
+			sys = current_idrng();
 			if (wi < len) {
 				coll++;
 			}
@@ -157,40 +1522,326 @@ t2geo_ln(const char *wkt, size_t len)
 			if (wi >= len) {
 				break;
 			}
-			sys = range_strp(wkt + wi, &eo, len);
-			if (UNLIKELY(eo == NULL)) {
+			/* only valid time repeats */
+			if (UNLIKELY(rstrp(&sys, 1U, wkt + wi, &eo,
+					   len - wi, 1U) != 1U ||
+				     eo == NULL)) {
 				rc = -1;
-				goto oh;
+				break;
 			}
 			/* reset WI */
 			wi = eo - wkt;
+			if (wi < len && wkt[wi] == ',') {
+				/* decision time, the line goes tri-temporal */
+				for (wi++; wi < len && isspace(wkt[wi]); wi++);
+				if (UNLIKELY(rstrp(&dec, 1U, wkt + wi, &eo,
+						   len - wi, 2U) != 1U ||
+					     eo == NULL)) {
+					rc = -1;
+					break;
+				}
+				wi = eo - wkt;
+				trip = true;
+			}
 			if (wi < len && wkt[wi] == ';') {
 				/* yep, semicolons allowed */
 				wi++;
 				coll++;
 			}
 		}
-		/* oki then */
-		if (coll == 1U) {
-			fputs("GEOMETRYCOLLECTION(", stdout);
-			coll++;
-		} else if (coll > 1U) {
-			fputc(',', stdout);
-			fputc(' ', stdout);
+		/* oki then, convert to geospatial */
+		echs_idrng_z(curz, dec);
+		for (size_t i = 0U; i < nv; i++) {
+			echs_box_t b = echs_idrng_box(vrng[i], sys);
+
+			/* the parsed ranges, not the box's, clamping loses */
+			echs_idrng_unixms(curms + 0U, vrng[i], 0U);
+			echs_idrng_unixms(curms + 2U, sys, 1U);
+			currec = nbox;
+			if (UNLIKELY(slab_push(&nbox, b) < 0)) {
+				rc = -1;
+				break;
+			}
+		}
+		if (UNLIKELY(rc < 0)) {
+			break;
 		}
-		/* convert to geospatial */
-		t2geo(val, sys);
 	}
 
-oh:
 	/* finalise the line */
-	if (coll) {
-		fputc(')', stdout);
+	if (rdf && !nbox) {
+		/* no statement without object */
+		obi = ob0;
+		return rc;
+	} else if (colp && !nbox) {
+		/* the caller leaves the field as is */
+		obi = ob0;
+		return -1;
+	}
+	if (simk && nbox > simk) {
+		/* covering for the index, exact collection for refinement */
+		size_t ns;
+
+		if (UNLIKELY(nbox > zsbox)) {
+			const size_t nuz = zlbox;
+			echs_box_t *nu = realloc(sbox, nuz * sizeof(*sbox));
+			double *nz = realloc(sz, 2U * nuz * sizeof(*sz));
+
+			if (nu != NULL) {
+				sbox = nu;
+			}
+			if (nz != NULL) {
+				sz = nz;
+			}
+			if (UNLIKELY(nu == NULL || nz == NULL)) {
+				return -1;
+			}
+			zsbox = nuz;
+		}
+		memcpy(sbox, lbox, nbox * sizeof(*lbox));
+		ns = echs_box_simplify(sbox, nbox, simk);
+		if (trip) {
+			/* coverings span the z envelope */
+			double zmin = lz[0U], zmax = lz[1U];
+
+			for (size_t i = 1U; i < nbox; i++) {
+				zmin = fmin(zmin, lz[2U * i + 0U]);
+				zmax = fmax(zmax, lz[2U * i + 1U]);
+			}
+			for (size_t i = 0U; i < ns; i++) {
+				sz[2U * i + 0U] = zmin;
+				sz[2U * i + 1U] = zmax;
+			}
+		}
+		pz = trip ? sz : NULL;
+		prec = NULL;
+		prnt(sbox, ns, ns > 1U);
+		pz = trip ? lz : NULL;
+		prec = lrec;
+		if (pgcp) {
+			prnt_ewkb(lbox, nbox, true);
+		} else {
+			obuf_addc('\t');
+			prnt_wkt(lbox, nbox, true);
+		}
+	} else {
+		pz = trip ? lz : NULL;
+		pms = lms;
+		prec = lrec;
+		prnt(lbox, nbox, coll > 0U || nbox > 1U);
+		if (pgcp && simk) {
+			/* the covering is the exact collection */
+			prnt(lbox, nbox, coll > 0U || nbox > 1U);
+		}
+	}
+	if (rdf && UNLIKELY(rdf_end(col, ncol, nc) < 0)) {
+		obi = ob0;
+		return -1;
+	}
+	if (!pgcp && !arrp && !gjsn && !colp) {
+		obuf_addc('\n');
+	}
+
+	if (hilbp) {
+		uint64_t h = 0U;
+
+		if (nbox) {
+			echs_box_t env = lbox[0U];
+
+			for (size_t i = 1U; i < nbox; i++) {
+				env = echs_box_union(env, lbox[i]);
+			}
+			h = echs_box_hilbert(env);
+		}
+		rc |= sort_push(h, obuf + ob0, obi - ob0);
+		obi = ob0;
+	} else if (obi >= 65536U && !colp) {
+		obuf_flush();
+	}
+	return rc;
+}
+
+static int
+t2geo_cols(const char *ln, size_t len)
+{
+/* convert picked columns in place, pass on the rest */
+	size_t ez = 0U;
+	size_t i = 0U;
+	int rc = 0;
+
+	/* line endings are kept */
+	ez += len > ez && ln[len - ez - 1U] == '\n';
+	ez += ez && len > ez && ln[len - ez - 1U] == '\r';
+	for (const char *sp = ln, *const ep = ln + len - ez, *fp;
+	     sp <= ep; sp = fp + 1U, i++) {
+		/* geometries have commas */
+		const bool qp = (sp < ep && *sp == '"') || cols->sep == ',';
+		const size_t ob0 = obi;
+		const char *s;
+		size_t n;
+
+		fp = cols_fend(cols, sp, ep);
+		if (i) {
+			obuf_addc(cols->sep);
+		}
+		if (!cols_pick_p(cols, i) || sp == fp) {
+			obuf_add(sp, fp - sp);
+			continue;
+		}
+		s = cols_field(cols, &n, sp, fp - sp);
+		if (qp) {
+			obuf_addc('"');
+		}
+		if (UNLIKELY(t2geo_ln(s, n) < 0)) {
+			obi = ob0 + !!i;
+			obuf_add(sp, fp - sp);
+			rc = -1;
+		} else if (qp) {
+			obuf_addc('"');
+		}
+	}
+	obuf_add(ln + len - ez, ez);
+	if (obi >= 65536U) {
+		obuf_flush();
 	}
-	fputc('\n', stdout);
 	return rc;
 }
 
+
+/* query windows */
+static const char*
+query_kw(const char *s, const char *ep, const char *kw)
+{
+/* match keyword KW and trailing whitespace, return what comes after */
+	const size_t kz = strlen(kw);
+
+	if ((size_t)(ep - s) <= kz || memcmp(s, kw, kz) || !isspace(s[kz])) {
+		return NULL;
+	}
+	for (s += kz; s < ep && isspace(*s); s++);
+	return s;
+}
+
+static echs_range_t
+query_at(echs_instant_t i)
+{
+/* all-day and all-sec instants span their day or second,
+ * other instants span their millisecond */
+	echs_range_t r = {i, i};
+
+	if (i.H != ECHS_ALL_DAY && i.ms != ECHS_ALL_SEC) {
+		r.end = echs_instant_add(i, (echs_idiff_t){0, 1U});
+	}
+	return r;
+}
+
+static int
+query_ln(const char *ln, size_t len)
+{
+	echs_range_t val = echs_max_range();
+	echs_range_t sys = echs_max_range();
+	const char *sp = ln;
+	const char *const ep = ln + len;
+	size_t ob0;
+	echs_box_t q;
+
+	/* allow prefixes */
+	with (const char *wp = memchr(ln, '\t', len)) {
+		if (wp != NULL) {
+			sp = ++wp;
+			obuf_add(ln, sp - ln);
+		}
+	}
+	ob0 = obi;
+
+	while (sp < ep) {
+		const char *p, *s;
+		char *on = NULL;
+
+		for (; sp < ep && isspace(*sp); sp++);
+		if ((p = query_kw(sp, ep, "valid")) != NULL) {
+			if ((s = query_kw(p, ep, "at")) != NULL) {
+				echs_instant_t i = dt_strp(s, &on, ep - s);
+
+				if (UNLIKELY(echs_nul_instant_p(i))) {
+					goto err;
+				}
+				val = query_at(i);
+			} else if ((s = query_kw(p, ep, "during")) != NULL) {
+				val = range_strp(s, &on, ep - s);
+			}
+		} else if ((p = query_kw(sp, ep, "known")) != NULL) {
+			if ((s = query_kw(p, ep, "as")) != NULL &&
+			    (s = query_kw(s, ep, "of")) != NULL) {
+				echs_instant_t i = dt_strp(s, &on, ep - s);
+
+				if (UNLIKELY(echs_nul_instant_p(i))) {
+					goto err;
+				}
+				sys = query_at(i);
+			} else if ((s = query_kw(p, ep, "between")) != NULL) {
+				/* dt_strp() would take ` and' for a time */
+				const char *a = s;
+
+				for (; a + 5U <= ep && memcmp(a, " and ", 5U); a++);
+				if (UNLIKELY(a + 5U > ep)) {
+					goto err;
+				}
+				sys.beg = dt_strp(s, &on, a - s);
+				if (UNLIKELY(echs_nul_instant_p(sys.beg))) {
+					goto err;
+				}
+				s = query_kw(a + 1U, ep, "and");
+				sys.end = dt_strp(s, &on, ep - s);
+				if (UNLIKELY(echs_nul_instant_p(sys.end))) {
+					goto err;
+				}
+			}
+		}
+		if (UNLIKELY(on == NULL)) {
+			goto err;
+		}
+		/* predicates are sep'd by comma */
+		for (sp = on; sp < ep && isspace(*sp); sp++);
+		if (sp < ep && *sp++ != ',') {
+			goto err;
+		}
+	}
+
+	q = echs_range_qbox(val, sys);
+	if (UNLIKELY(q.from[0U] > q.to[0U] || q.from[1U] > q.to[1U])) {
+		goto err;
+	} else if (UNLIKELY(!echs_range_qbox_exact_p(q, val, sys))) {
+		goto clmp;
+	}
+	if (prnt == prnt_wkt) {
+		char buf[256U];
+
+		obuf_add(buf, qbox_strf(buf, sizeof(buf), q));
+	} else {
+		prnt(&q, 1U, false);
+	}
+	obuf_addc('\n');
+	if (obi >= 65536U) {
+		obuf_flush();
+	}
+	return 0;
+
+err:
+	fprintf(stderr, "\
+Error: cannot parse query `%.*s'\n", (int)len, ln);
+	goto nil;
+clmp:
+	fprintf(stderr, "\
+Error: query `%.*s' reaches beyond the mapped time range\n", (int)len, ln);
+nil:
+	/* keep the line so results stay in step with their queries */
+	obi = ob0;
+	obuf_addc('\n');
+	return -1;
+}
+
+
 
 #include "t2geo.yucc"
 
@@ -205,10 +1856,319 @@ main(int argc, char *argv[])
 		goto out;
 	}
 
+	if (argi->sort_memory_arg) {
+		char *on = NULL;
+		unsigned long long int z = strtoull(argi->sort_memory_arg, &on, 10);
+
+		switch (*on) {
+		case 'G':
+		case 'g':
+			z *= 1024U;
+			/*@fallthrough@*/
+		case 'M':
+		case 'm':
+			z *= 1024U;
+			/*@fallthrough@*/
+		case 'K':
+		case 'k':
+			z *= 1024U;
+			on++;
+			/*@fallthrough@*/
+		case '\0':
+			break;
+		default:
+			z = 0U;
+			break;
+		}
+		if (UNLIKELY(!z || *on)) {
+			fprintf(stderr, "\
+Error: cannot parse memory size `%s'\n", argi->sort_memory_arg);
+			rc = 1;
+			goto out;
+		}
+		sortz = z;
+	}
+	hilbp = argi->hilbert_flag;
+	if (argi->format_arg) {
+		static const struct {
+			const char *name;
+			void(*prnt)(const echs_box_t*, size_t, bool);
+			unsigned int rdf;
+		} fmts[] = {
+			{"wkt", prnt_wkt, RDF_NONE},
+			{"zorder", prnt_zorder, RDF_NONE},
+			{"cover", prnt_cover, RDF_NONE},
+			{"nt", prnt_wkt, RDF_NT},
+			{"nq", prnt_wkt, RDF_NQ},
+			{"pgcopy", prnt_ewkb, RDF_NONE},
+			{"arrow", prnt_arrow, RDF_NONE},
+			{"geojson", prnt_geojson, RDF_NONE},
+		};
+		size_t i;
+
+		for (i = 0U; i < countof(fmts) &&
+			     strcmp(argi->format_arg, fmts[i].name); i++);
+		if (UNLIKELY(i >= countof(fmts))) {
+			fprintf(stderr, "\
+Error: unknown output format `%s'\n", argi->format_arg);
+			rc = 1;
+			goto out;
+		}
+		prnt = fmts[i].prnt;
+		rdf = fmts[i].rdf;
+		pgcp = prnt == prnt_ewkb;
+		arrp = prnt == prnt_arrow;
+		gjsn = prnt == prnt_geojson;
+	}
+	rdfg = argi->graph_arg;
+	rdfp = argi->prefix_args;
+	nrdfp = argi->prefix_nargs;
+	for (size_t i = 0U; i < nrdfp; i++) {
+		const char *eq = strchr(rdfp[i], '=');
+
+		if (UNLIKELY(eq == NULL || !rdf_scheme(eq + 1U, strlen(eq + 1U)) ||
+			     memchr(rdfp[i], ':', eq - rdfp[i]))) {
+			fprintf(stderr, "\
+Error: prefix `%s' is not of the form P=IRI\n", rdfp[i]);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (rdfg != NULL) {
+		const char *g = rdfg;
+		size_t ng = strlen(rdfg);
+
+		if (UNLIKELY(rdf_iri(&g, &ng) == NULL)) {
+			fprintf(stderr, "\
+Error: graph `%s' is neither an absolute IRI nor a known prefixed name\n",
+				rdfg);
+			rc = 1;
+			goto out;
+		}
+	}
+	gjnames = argi->properties_arg;
+	if (argi->srid_arg) {
+		char *on = NULL;
+		unsigned long int s = strtoul(argi->srid_arg, &on, 10);
+
+		if (UNLIKELY(*on || !s || s > 999999U)) {
+			fprintf(stderr, "\
+Error: srid must be between 1 and 999999\n");
+			rc = 1;
+			goto out;
+		}
+		srid = s;
+	}
+	bmap = echs_box_defmap;
+	if (UNLIKELY(echs_boxmap_strp(
+			     &bmap, argi->epoch_arg, argi->scale_arg,
+			     argi->warp_arg) < 0)) {
+		fprintf(stderr, "\
+Error: cannot parse epoch, scale or warp\n");
+		rc = 1;
+		goto out;
+	}
+	echs_box_setmap(bmap);
+	if (argi->slab_arg) {
+		const char *a = argi->slab_arg;
+		const size_t z = strlen(a);
+		char *on = NULL;
+		echs_idiff_t d = idiff_strp(a, &on, z);
+
+		/* idiff_strp() leaves ON past the terminator,
+		 * anywhere before it means trailing garbage */
+		for (size_t i = 0U; i < 2U; i++) {
+			slabg[i] = idiff2geoflt(d, ldexp(1, -bmap.scale[i]));
+		}
+		if (UNLIKELY(on != a + z + 1U ||
+			     !(slabg[0U] > 0) || !(slabg[1U] > 0))) {
+			fprintf(stderr, "\
+Error: cannot parse slab width `%s'\n", a);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->max_slabs_arg) {
+		char *on = NULL;
+		unsigned long int n = strtoul(argi->max_slabs_arg, &on, 10);
+
+		if (UNLIKELY(*on || n < 2U || n > 65536U)) {
+			fprintf(stderr, "\
+Error: max-slabs must be between 2 and 65536\n");
+			rc = 1;
+			goto out;
+		}
+		maxslabs = n;
+	}
+	if (slabg[0U] > 0) {
+		cuts[0U] = malloc((maxslabs + 1U) * sizeof(*cuts[0U]));
+		cuts[1U] = malloc((maxslabs + 1U) * sizeof(*cuts[1U]));
+		if (UNLIKELY(cuts[0U] == NULL || cuts[1U] == NULL)) {
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->simplify_arg) {
+		char *on = NULL;
+		unsigned long int k = strtoul(argi->simplify_arg, &on, 10);
+
+		if (UNLIKELY(*on || !k)) {
+			fprintf(stderr, "\
+Error: simplify needs a positive number of boxes\n");
+			rc = 1;
+			goto out;
+		}
+		simk = k;
+	}
+	if (rdf && simk) {
+		fprintf(stderr, "\
+Error: simplify cannot be used with RDF output\n");
+		rc = 1;
+		goto out;
+	}
+	if ((arrp || gjsn) && (simk || hilbp || argi->query_flag)) {
+		fprintf(stderr, "\
+Error: simplify, hilbert and query cannot be used with %s output\n",
+			argi->format_arg);
+		rc = 1;
+		goto out;
+	}
+	if ((rdf || pgcp) && argi->query_flag) {
+		fprintf(stderr, "\
+Error: query cannot be used with %s output\n", argi->format_arg);
+		rc = 1;
+		goto out;
+	}
+	if (argi->input_arg) {
+		if (!strcmp(argi->input_arg, "epoch-s") ||
+		    (epochms = !strcmp(argi->input_arg, "epoch-ms"))) {
+			rstrp = epoch_strp;
+		} else if (UNLIKELY(strcmp(argi->input_arg, "iso"))) {
+			fprintf(stderr, "\
+Error: unknown input format `%s'\n", argi->input_arg);
+			rc = 1;
+			goto out;
+		}
+		if (UNLIKELY(rstrp != iso_strp && argi->query_flag)) {
+			fputs("\
+Error: query predicates need iso input\n", stderr);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->csv_flag) {
+		cols->sep = ',';
+	}
+	if ((colp = argi->columns_arg != NULL)) {
+		if (UNLIKELY(cols_strp(cols, argi->columns_arg) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse columns `%s'\n", argi->columns_arg);
+			rc = 1;
+			goto out;
+		} else if (UNLIKELY(rdf || pgcp || arrp || gjsn)) {
+			fprintf(stderr, "\
+Error: columns cannot be used with %s output\n", argi->format_arg);
+			rc = 1;
+			goto out;
+		} else if (UNLIKELY(simk || hilbp || argi->query_flag)) {
+			fprintf(stderr, "\
+Error: simplify, hilbert and query cannot be used with columns\n");
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->batch_size_arg) {
+		char *on = NULL;
+		unsigned long int n = strtoul(argi->batch_size_arg, &on, 10);
+
+		if (UNLIKELY(*on || !n || n > 16777216U)) {
+			fprintf(stderr, "\
+Error: batch-size must be between 1 and 16777216\n");
+			rc = 1;
+			goto out;
+		}
+		arrz = n;
+	}
+	if (argi->max_ranges_arg) {
+		char *on = NULL;
+		unsigned long int k = strtoul(argi->max_ranges_arg, &on, 10);
+
+		if (UNLIKELY(*on || k < 4U || k > 65536U)) {
+			fprintf(stderr, "\
+Error: max-ranges must be between 4 and 65536\n");
+			rc = 1;
+			goto out;
+		}
+		maxrngs = k;
+	}
+	if (argi->max_cells_arg) {
+		char *on = NULL;
+		unsigned long int k = strtoul(argi->max_cells_arg, &on, 10);
+
+		if (UNLIKELY(*on || k < 4U || k > 65536U)) {
+			fprintf(stderr, "\
+Error: max-cells must be between 4 and 65536\n");
+			rc = 1;
+			goto out;
+		}
+		maxcells = k;
+	}
+	if (argi->bits_arg) {
+		char *on = NULL;
+		unsigned long int b = strtoul(argi->bits_arg, &on, 10);
+
+		if (UNLIKELY(*on || !b || b > 32U)) {
+			fprintf(stderr, "\
+Error: bits must be between 1 and 32\n");
+			rc = 1;
+			goto out;
+		}
+		zbits = b;
+	}
+	if (prnt == prnt_cover && UNLIKELY(zbits > 30U)) {
+		fprintf(stderr, "\
+Error: cover supports at most 30 bits\n");
+		rc = 1;
+		goto out;
+	}
+
+	if (pgcp) {
+		/* signature (NUL included), flags, header extension length */
+		obuf_add(PGCOPY_SIG, sizeof(PGCOPY_SIG));
+		obuf_be32(0U);
+		obuf_be32(0U);
+		obuf_flush();
+	}
+	if (arrp) {
+		rc |= boxarrow_beg(obuf_add) < 0;
+		obuf_flush();
+	}
+	if (gjsn) {
+		static const char hdr[] = "\
+{\"type\":\"FeatureCollection\",\"features\":[\n";
+		obuf_add(hdr, strlenof(hdr));
+	}
+
 	/* set current time */
-	now = time(NULL) - reftm_time;
+	now = time(NULL) - echs_instant_to_epoch(bmap.epoch[1U]);
+
+	if (!argi->nargs && colp) {
+		char *line = NULL;
+		size_t llen = 0U;
+		ssize_t nrd;
 
-	if (!argi->nargs) {
+		if (argi->header_flag &&
+		    (nrd = cols_getrec(cols, &line, &llen, stdin)) > 0) {
+			obuf_add(line, nrd);
+		}
+		while ((nrd = cols_getrec(cols, &line, &llen, stdin)) > 0) {
+			rc |= t2geo_cols(line, nrd) < 0;
+		}
+		free(line);
+		cols_fini(cols);
+	} else if (!argi->nargs) {
+		int(*proc)(const char*, size_t) =
+			argi->query_flag ? query_ln : t2geo_ln;
 		char *line = NULL;
 		size_t llen = 0U;
 
@@ -216,9 +2176,37 @@ main(int argc, char *argv[])
 			if (LIKELY(line[nrd - 1U] == '\n')) {
 				nrd--;
 			}
-			rc |= t2geo_ln(line, nrd) < 0;
+			rc |= proc(line, nrd) < 0;
 		}
+		free(line);
+	}
+	if (hilbp) {
+		rc |= sort_fin() < 0;
+	}
+	if (pgcp) {
+		/* file trailer */
+		obuf_be16(-1);
+	}
+	if (arrp) {
+		/* last batch and end of stream */
+		rc |= boxarrow_end(obuf_add) < 0;
+	}
+	if (gjsn) {
+		obuf_add("\n]}\n", 4U);
 	}
+	obuf_flush();
+	rc |= oberr < 0;
+	free(lbox);
+	free(vrng);
+	free(rrng);
+	free(cells);
+	free(cuts[0U]);
+	free(cuts[1U]);
+	free(sbox);
+	free(sz);
+	free(lz);
+	free(lms);
+	free(lrec);
 
 out:
 	yuck_free(argi);
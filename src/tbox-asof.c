@@ -0,0 +1,209 @@
+/*** tbox-asof.c -- bitemporal as-of snapshots
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include "dt-strpf.h"
+#include "nifty.h"
+
+static echs_instant_t asof_sys;
+static echs_instant_t asof_val;
+
+
+static int
+asof_ln(const char *ln, size_t len)
+{
+	size_t npr = 0U;
+	size_t wi = 0U;
+	size_t zpre = 0U;
+	int rc = 0;
+
+	/* allow prefixes */
+	with (const char *wp = memchr(ln, '\t', len)) {
+		if (wp != NULL) {
+			wi = zpre = ++wp - ln;
+		}
+	}
+
+	/* read them intervals */
+	while (wi < len) {
+		echs_range_t val;
+		echs_range_t sys;
+		size_t bo, eo;
+		char *on = NULL;
+
+		for (; wi < len && (isspace(ln[wi]) || ln[wi] == ';'); wi++);
+		if (wi >= len) {
+			break;
+		}
+		bo = wi;
+		val = range_strp(ln + wi, &on, len - wi);
+		if (UNLIKELY(on == NULL)) {
+			rc = -1;
+			break;
+		}
+		wi = on - ln;
+		sys = echs_max_range();
+		if (wi < len && ln[wi] == ',') {
+			for (wi++; wi < len && isspace(ln[wi]); wi++);
+			on = NULL;
+			sys = range_strp(ln + wi, &on, len - wi);
+			if (UNLIKELY(on == NULL)) {
+				rc = -1;
+				break;
+			}
+			wi = on - ln;
+		}
+		eo = wi;
+
+		/* check against snapshot */
+		if (!echs_in_range_p(asof_sys, echs_range_unfix(sys))) {
+			continue;
+		} else if (!echs_nul_instant_p(asof_val) &&
+			   !echs_in_range_p(asof_val, echs_range_unfix(val))) {
+			continue;
+		}
+		/* print prefix and separator */
+		if (!npr++) {
+			fwrite(ln, 1, zpre, stdout);
+		} else {
+			fputc(';', stdout);
+			fputc(' ', stdout);
+		}
+		fwrite(ln + bo, 1, eo - bo, stdout);
+	}
+
+	/* finalise the line */
+	if (npr) {
+		fputc('\n', stdout);
+	}
+	return rc;
+}
+
+static echs_instant_t
+instant_arg(const char *arg)
+{
+	char *on = NULL;
+	echs_instant_t res = dt_strp(arg, &on, strlen(arg));
+
+	if (UNLIKELY(on == NULL || *on)) {
+		fprintf(stderr, "\
+Error: cannot parse instant `%s'\n", arg);
+		return echs_nul_instant();
+	}
+	/* unfix him, all-day means midnight */
+	if (echs_instant_all_day_p(res)) {
+		res.H = 0, res.M = 0, res.S = 0, res.ms = 0;
+	} else if (echs_instant_all_sec_p(res)) {
+		res.ms = 0;
+	}
+	return res;
+}
+
+static int
+asof_fp(FILE *fp)
+{
+	char *line = NULL;
+	size_t llen = 0U;
+	int rc = 0;
+
+	for (ssize_t nrd; (nrd = getline(&line, &llen, fp)) > 0;) {
+		if (LIKELY(line[nrd - 1U] == '\n')) {
+			nrd--;
+		}
+		rc |= asof_ln(line, nrd) < 0;
+	}
+	free(line);
+	return rc;
+}
+
+
+#include "tbox-asof.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->system_arg == NULL) {
+		asof_sys = epoch_to_echs_instant(time(NULL));
+	} else if (echs_nul_instant_p(asof_sys = instant_arg(argi->system_arg))) {
+		rc = 1;
+		goto out;
+	}
+	if (argi->valid_arg == NULL) {
+		;
+	} else if (echs_nul_instant_p(asof_val = instant_arg(argi->valid_arg))) {
+		rc = 1;
+		goto out;
+	}
+
+	if (!argi->nargs) {
+		rc |= asof_fp(stdin);
+	}
+	for (size_t i = 0U; i < argi->nargs; i++) {
+		const char *fn = argi->args[i];
+		FILE *fp;
+
+		if (UNLIKELY((fp = fopen(fn, "r")) == NULL)) {
+			fprintf(stderr, "\
+Error: cannot open file `%s': %s\n", fn, strerror(errno));
+			rc = 1;
+			continue;
+		}
+		rc |= asof_fp(fp);
+		fclose(fp);
+	}
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* tbox-asof.c ends here */
@@ -0,0 +1,339 @@
+/*** tbox-hist.c -- activity histograms over interval streams
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "dt-strpf.h"
+#include "nifty.h"
+
+static const echs_instant_t reftm = {
+	.y = 2000,
+	.m = 1,
+	.d = 1,
+	.H = 0,
+	.M = 0,
+	.S = 0,
+	.ms = 0,
+};
+
+/* begin and end events in msecs since reftm */
+static int64_t *begs;
+static int64_t *ends;
+static size_t nevs;
+static size_t zevs;
+static unsigned int sysp;
+
+
+static inline int64_t
+instant2ms(echs_instant_t i)
+{
+	echs_idiff_t d;
+
+	if (UNLIKELY(echs_min_instant_p(i))) {
+		return INT64_MIN;
+	} else if (UNLIKELY(echs_max_instant_p(i))) {
+		return INT64_MAX;
+	}
+	d = echs_instant_diff(i, reftm);
+	return (int64_t)d.dpart * MSECS_PER_DAY + d.intra;
+}
+
+static inline echs_idiff_t
+ms2idiff(int64_t ms)
+{
+	int64_t dpart = ms / (int64_t)MSECS_PER_DAY;
+	int64_t intra = ms % (int64_t)MSECS_PER_DAY;
+
+	if (intra < 0) {
+		intra += MSECS_PER_DAY;
+		dpart--;
+	}
+	return (echs_idiff_t){(int32_t)dpart, (uint32_t)intra};
+}
+
+static int
+i64cmp(const void *a, const void *b)
+{
+	const int64_t x = *(const int64_t*)a;
+	const int64_t y = *(const int64_t*)b;
+	return (x > y) - (x < y);
+}
+
+static int
+push_ev(echs_range_t r)
+{
+	int64_t b, e;
+
+	r = echs_range_unfix(r);
+	b = instant2ms(r.beg);
+	e = instant2ms(r.end);
+	if (UNLIKELY(b >= e)) {
+		/* empty */
+		return 0;
+	}
+	if (UNLIKELY(nevs >= zevs)) {
+		const size_t nuz = (zevs * 2U) ?: 4096U;
+		int64_t *nb = realloc(begs, nuz * sizeof(*begs));
+		int64_t *ne;
+
+		if (UNLIKELY(nb == NULL)) {
+			return -1;
+		}
+		begs = nb;
+		if (UNLIKELY((ne = realloc(ends, nuz * sizeof(*ends))) == NULL)) {
+			return -1;
+		}
+		ends = ne;
+		zevs = nuz;
+	}
+	begs[nevs] = b;
+	ends[nevs] = e;
+	nevs++;
+	return 0;
+}
+
+static int
+hist_ln(const char *ln, size_t len)
+{
+	size_t wi = 0U;
+
+	/* allow prefixes */
+	with (const char *wp = memchr(ln, '\t', len)) {
+		if (wp != NULL) {
+			wi += ++wp - ln;
+		}
+	}
+
+	/* read them intervals */
+	while (wi < len) {
+		echs_range_t r[2U];
+		char *eo = NULL;
+
+		for (; wi < len && (isspace(ln[wi]) || ln[wi] == ';'); wi++);
+		if (wi >= len) {
+			break;
+		}
+		r[0U] = range_strp(ln + wi, &eo, len - wi);
+		if (UNLIKELY(eo == NULL)) {
+			return -1;
+		}
+		wi = eo - ln;
+		r[1U] = echs_max_range();
+		if (wi < len && ln[wi] == ',') {
+			for (wi++; wi < len && isspace(ln[wi]); wi++);
+			eo = NULL;
+			r[1U] = range_strp(ln + wi, &eo, len - wi);
+			if (UNLIKELY(eo == NULL)) {
+				return -1;
+			}
+			wi = eo - ln;
+		}
+		if (UNLIKELY(push_ev(r[sysp]) < 0)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int64_t
+floor_to(int64_t x, int64_t w)
+{
+	int64_t r = x % w;
+	return x - r - (r < 0 ? w : 0);
+}
+
+static void
+sweep(int64_t from, int64_t till, int64_t w)
+{
+/* for a bucket [T, T + W) the number of intervals intersecting it
+ * is the number of begins before T + W minus the number of ends up
+ * to and including T */
+	const bool dayp = !(w % (int64_t)MSECS_PER_DAY);
+	echs_instant_t t;
+	size_t ib = 0U;
+	size_t ie = 0U;
+
+	qsort(begs, nevs, sizeof(*begs), i64cmp);
+	qsort(ends, nevs, sizeof(*ends), i64cmp);
+
+	from = floor_to(from, w);
+	t = echs_instant_add(reftm, ms2idiff(from));
+	for (int64_t x = from; x <= till; x += w) {
+		char buf[64U];
+		size_t z;
+
+		for (; ib < nevs && begs[ib] < x + w; ib++);
+		for (; ie < nevs && ends[ie] <= x; ie++);
+
+		if (dayp) {
+			t.H = ECHS_ALL_DAY;
+		} else if (!t.ms) {
+			t.ms = ECHS_ALL_SEC;
+		}
+		z = dt_strf(buf, sizeof(buf), t);
+		buf[z++] = '\t';
+		z += snprintf(buf + z, sizeof(buf) - z, "%zu\n", ib - ie);
+		fwrite(buf, 1, z, stdout);
+
+		/* unfix T and advance */
+		if (dayp) {
+			t.H = 0;
+		} else if (echs_instant_all_sec_p(t)) {
+			t.ms = 0;
+		}
+		t = echs_instant_add(t, ms2idiff(w));
+	}
+	return;
+}
+
+static int
+instant_arg(int64_t *tgt, const char *arg)
+{
+	char *on = NULL;
+	echs_instant_t i = dt_strp(arg, &on, strlen(arg));
+
+	if (UNLIKELY(on == NULL || *on)) {
+		fprintf(stderr, "\
+Error: cannot parse instant `%s'\n", arg);
+		return -1;
+	}
+	/* unfix him, all-day means midnight */
+	if (echs_instant_all_day_p(i)) {
+		i.H = 0, i.M = 0, i.S = 0, i.ms = 0;
+	} else if (echs_instant_all_sec_p(i)) {
+		i.ms = 0;
+	}
+	*tgt = instant2ms(i);
+	return 0;
+}
+
+
+#include "tbox-hist.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int64_t w = MSECS_PER_DAY;
+	int64_t from = INT64_MAX;
+	int64_t till = INT64_MIN;
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->interval_arg) {
+		const char *s = argi->interval_arg;
+		const size_t z = strlen(s);
+		char *on = NULL;
+		echs_idiff_t d = idiff_strp(s, &on, z);
+
+		/* idiff_strp() leaves ON past the terminator,
+		 * anywhere before it means trailing garbage */
+		w = (int64_t)d.dpart * MSECS_PER_DAY + d.intra;
+		if (UNLIKELY(on != s + z + 1U || w <= 0)) {
+			fprintf(stderr, "\
+Error: cannot parse bucket width `%s'\n", s);
+			rc = 1;
+			goto out;
+		}
+	}
+	if (argi->from_arg && instant_arg(&from, argi->from_arg) < 0) {
+		rc = 1;
+		goto out;
+	}
+	if (argi->till_arg && instant_arg(&till, argi->till_arg) < 0) {
+		rc = 1;
+		goto out;
+	}
+	sysp = argi->system_flag;
+
+	{
+		char *line = NULL;
+		size_t llen = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			if (LIKELY(line[nrd - 1U] == '\n')) {
+				nrd--;
+			}
+			rc |= hist_ln(line, nrd) < 0;
+		}
+	}
+
+	/* determine output range from the finite end points */
+	if (!argi->from_arg || !argi->till_arg) {
+		int64_t lo = INT64_MAX;
+		int64_t hi = INT64_MIN;
+
+		for (size_t i = 0U; i < nevs; i++) {
+			if (begs[i] > INT64_MIN && begs[i] < lo) {
+				lo = begs[i];
+			}
+			if (begs[i] > hi) {
+				hi = begs[i];
+			}
+			if (ends[i] < INT64_MAX && ends[i] > hi) {
+				/* ends are exclusive */
+				hi = ends[i] - 1;
+			}
+			if (ends[i] < INT64_MAX && ends[i] - 1 < lo) {
+				lo = ends[i] - 1;
+			}
+		}
+		if (!argi->from_arg) {
+			from = lo;
+		}
+		if (!argi->till_arg) {
+			till = hi;
+		}
+	}
+	if (from <= till) {
+		sweep(from, till, w);
+	}
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* tbox-hist.c ends here */
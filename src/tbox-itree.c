@@ -0,0 +1,531 @@
+/*** tbox-itree.c -- static interval trees over validity ranges
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dt-strpf.h"
+#include "nifty.h"
+
+/* the on-disk tree, all values in native byte order,
+ * nodes are sorted by their beginning and form an implicit binary
+ * tree in in-order layout: node X on level K has children
+ * X -/+ 2^(K - 1), the root is 2^ROOTK - 1; each node carries the
+ * maximum end of its subtree so whole subtrees can be skipped.
+ * The nodes are followed by the key pool, nul-terminated strings. */
+typedef struct {
+	/* instant keys, see echs_instant_key(), of the unfixed range */
+	uint64_t beg;
+	uint64_t end;
+	/* maximum END in this subtree */
+	uint64_t max;
+	/* offset of the key in the pool */
+	uint64_t koff;
+} node_t;
+
+typedef struct {
+	char magic[8U];
+	uint32_t rootk;
+	uint32_t pad;
+	uint64_t nnod;
+	uint64_t poolz;
+	node_t nod[];
+} itree_t;
+
+static const char itree_magic[8U] = "tboxitr1";
+
+
+/* builder */
+static node_t *nods;
+static size_t nnod;
+static size_t znod;
+
+static char *pool;
+static size_t poolz;
+static size_t poolp;
+
+static unsigned int sysp;
+
+static int
+push_key(const char *key, size_t len)
+{
+	if (UNLIKELY(poolp + len + 1U > poolz)) {
+		size_t nuz = (poolz * 2U) ?: 65536U;
+		char *nu;
+
+		for (; nuz < poolp + len + 1U; nuz *= 2U);
+		if (UNLIKELY((nu = realloc(pool, nuz)) == NULL)) {
+			return -1;
+		}
+		pool = nu;
+		poolz = nuz;
+	}
+	memcpy(pool + poolp, key, len);
+	pool[poolp + len] = '\0';
+	poolp += len + 1U;
+	return 0;
+}
+
+static int
+push_rng(echs_range_t r, uint64_t koff)
+{
+	const uint64_t b = echs_instant_key((r = echs_range_unfix(r)).beg);
+	const uint64_t e = echs_instant_key(r.end);
+
+	if (UNLIKELY(b >= e)) {
+		/* empty */
+		return 0;
+	} else if (UNLIKELY(nnod >= znod)) {
+		const size_t nuz = (znod * 2U) ?: 4096U;
+		node_t *nu = realloc(nods, nuz * sizeof(*nods));
+
+		if (UNLIKELY(nu == NULL)) {
+			return -1;
+		}
+		nods = nu;
+		znod = nuz;
+	}
+	nods[nnod++] = (node_t){b, e, e, koff};
+	return 0;
+}
+
+static int
+build_ln(const char *ln, size_t len)
+{
+	const uint64_t koff = poolp;
+	size_t wi = 0U;
+
+	/* the prefix is the key */
+	with (const char *wp = memchr(ln, '\t', len)) {
+		if (wp != NULL) {
+			wi = wp - ln;
+		}
+		if (UNLIKELY(push_key(ln, wi) < 0)) {
+			return -1;
+		}
+		wi += wp != NULL;
+	}
+
+	/* read them intervals */
+	while (wi < len) {
+		echs_range_t r[2U];
+		char *eo = NULL;
+
+		for (; wi < len && (isspace(ln[wi]) || ln[wi] == ';'); wi++);
+		if (wi >= len) {
+			break;
+		}
+		r[0U] = range_strp(ln + wi, &eo, len - wi);
+		if (UNLIKELY(eo == NULL)) {
+			return -1;
+		}
+		wi = eo - ln;
+		r[1U] = echs_max_range();
+		if (wi < len && ln[wi] == ',') {
+			for (wi++; wi < len && isspace(ln[wi]); wi++);
+			eo = NULL;
+			r[1U] = range_strp(ln + wi, &eo, len - wi);
+			if (UNLIKELY(eo == NULL)) {
+				return -1;
+			}
+			wi = eo - ln;
+		}
+		if (UNLIKELY(push_rng(r[sysp], koff) < 0)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+node_cmp(const void *a, const void *b)
+{
+	const node_t *x = a;
+	const node_t *y = b;
+	return (x->beg > y->beg) - (x->beg < y->beg);
+}
+
+static uint32_t
+augment(node_t *restrict nod, size_t n)
+{
+/* compute subtree maxima bottom-up, nodes beyond N are virtual and
+ * take over the maximum of the rightmost real subtree below them */
+	size_t last_i = 0U;
+	uint64_t last = 0U;
+	uint32_t k;
+
+	for (size_t i = 0U; i < n; i += 2U) {
+		last_i = i;
+		last = nod[i].max = nod[i].end;
+	}
+	for (k = 1U; (size_t)1U << k <= n; k++) {
+		const size_t x = (size_t)1U << (k - 1U);
+		const size_t i0 = (x << 1U) - 1U;
+		const size_t step = x << 2U;
+
+		for (size_t i = i0; i < n; i += step) {
+			const uint64_t el = nod[i - x].max;
+			const uint64_t er = i + x < n ? nod[i + x].max : last;
+			uint64_t e = nod[i].end;
+
+			e = e > el ? e : el;
+			e = e > er ? e : er;
+			nod[i].max = e;
+		}
+		last_i = last_i >> k & 1U ? last_i - x : last_i + x;
+		if (last_i < n && nod[last_i].max > last) {
+			last = nod[last_i].max;
+		}
+	}
+	return k - 1U;
+}
+
+static int
+build(const char *fn)
+{
+	itree_t hdr = {.nnod = nnod, .poolz = poolp};
+	FILE *fp;
+	int rc = 0;
+
+	memcpy(hdr.magic, itree_magic, sizeof(itree_magic));
+	qsort(nods, nnod, sizeof(*nods), node_cmp);
+	hdr.rootk = nnod ? augment(nods, nnod) : 0U;
+
+	if (UNLIKELY((fp = fopen(fn, "wb")) == NULL)) {
+		return -1;
+	}
+	fwrite(&hdr, sizeof(hdr), 1U, fp);
+	fwrite(nods, sizeof(*nods), nnod, fp);
+	fwrite(pool, 1, poolp, fp);
+	if (UNLIKELY(ferror(fp))) {
+		rc = -1;
+	}
+	rc |= -(fclose(fp) < 0);
+	return rc;
+}
+
+
+/* querying */
+static const itree_t *it;
+static size_t itz;
+static const char *itpool;
+/* number of the current instant, 0 if results aren't numbered */
+static size_t qno;
+
+static int
+itree_open(const char *fn)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) {
+		return -1;
+	} else if (fstat(fd, &st) < 0) {
+		goto clo;
+	} else if ((size_t)st.st_size < sizeof(*it)) {
+		errno = 0;
+		goto clo;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		goto clo;
+	}
+	it = p;
+	itz = st.st_size;
+	if (memcmp(it->magic, itree_magic, sizeof(itree_magic)) ||
+	    sizeof(*it) + it->nnod * sizeof(*it->nod) + it->poolz != itz) {
+		munmap(p, itz);
+		it = NULL;
+		errno = 0;
+		goto clo;
+	}
+	itpool = (const void*)(it->nod + it->nnod);
+	close(fd);
+	return 0;
+
+clo:
+	close(fd);
+	return -1;
+}
+
+static void
+itree_close(void)
+{
+	if (it != NULL) {
+		munmap(deconst(it), itz);
+		it = NULL;
+	}
+	return;
+}
+
+static void
+prnt_node(const node_t *x)
+{
+	const echs_range_t r = {
+		echs_key_instant(x->beg), echs_key_instant(x->end)
+	};
+	const char *key = itpool + x->koff;
+	char buf[256U];
+	size_t z = 0U;
+
+	if (qno) {
+		printf("%zu\t", qno);
+	}
+	if (*key) {
+		fputs(key, stdout);
+		buf[z++] = '\t';
+	}
+	z += range_strf(buf + z, sizeof(buf) - z, echs_range_fixup(r));
+	buf[z++] = '\n';
+	fwrite(buf, 1, z, stdout);
+	return;
+}
+
+static size_t
+stab(uint64_t t)
+{
+/* find nodes with BEG <= T < END */
+	const node_t *nod = it->nod;
+	const size_t n = it->nnod;
+	struct {
+		size_t x;
+		uint32_t k;
+		uint32_t w;
+	} stk[128U];
+	size_t nstk = 0U;
+	size_t nres = 0U;
+
+	if (UNLIKELY(!n)) {
+		return 0U;
+	}
+	stk[nstk++] = (__typeof__(*stk)){((size_t)1U << it->rootk) - 1U, it->rootk, 0U};
+	while (nstk) {
+		const __typeof__(*stk) z = stk[--nstk];
+
+		if (z.k <= 3U) {
+			/* small subtrees are scanned linearly */
+			const size_t i0 = z.x >> z.k << z.k;
+			size_t i1 = i0 + ((size_t)1U << (z.k + 1U)) - 1U;
+
+			if (i1 >= n) {
+				i1 = n;
+			}
+			for (size_t i = i0; i < i1 && nod[i].beg <= t; i++) {
+				if (t < nod[i].end) {
+					prnt_node(nod + i);
+					nres++;
+				}
+			}
+		} else if (!z.w) {
+			/* descend left first, if anything there ends after T */
+			const size_t y = z.x - ((size_t)1U << (z.k - 1U));
+
+			stk[nstk++] = (__typeof__(*stk)){z.x, z.k, 1U};
+			if (y >= n || nod[y].max > t) {
+				stk[nstk++] = (__typeof__(*stk)){y, z.k - 1U, 0U};
+			}
+		} else if (z.x < n && nod[z.x].beg <= t) {
+			if (t < nod[z.x].end) {
+				prnt_node(nod + z.x);
+				nres++;
+			}
+			stk[nstk++] = (__typeof__(*stk)){
+				z.x + ((size_t)1U << (z.k - 1U)), z.k - 1U, 0U};
+		}
+	}
+	return nres;
+}
+
+static int
+stab_ln(const char *ln, size_t len)
+{
+	echs_instant_t i;
+	char *on = NULL;
+
+	for (; len && isspace(*ln); ln++, len--);
+	for (; len && isspace(ln[len - 1U]); len--);
+	i = dt_strp(ln, &on, len);
+	if (UNLIKELY(on == NULL || on != ln + len || !len)) {
+		return -1;
+	}
+	/* unfix him, all-day means midnight */
+	if (echs_instant_all_day_p(i)) {
+		i.H = 0, i.M = 0, i.S = 0, i.ms = 0;
+	} else if (echs_instant_all_sec_p(i)) {
+		i.ms = 0;
+	}
+	stab(echs_instant_key(i));
+	return 0;
+}
+
+
+#include "tbox-itree.yucc"
+
+static int
+cmd_build(const yuck_t argi[static 1U])
+{
+	const char *fn;
+	int rc = 0;
+
+	if (argi->nargs != 1U) {
+		yuck_auto_help(argi);
+		return 1;
+	}
+	fn = argi->args[0U];
+	sysp = argi->build.system_flag;
+
+	{
+		char *line = NULL;
+		size_t llen = 0U;
+		size_t nln = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			nln++;
+			if (LIKELY(line[nrd - 1U] == '\n')) {
+				nrd--;
+			}
+			if (UNLIKELY(build_ln(line, nrd) < 0)) {
+				fprintf(stderr, "\
+Warning: cannot process line %zu\n", nln);
+				rc = 1;
+			}
+		}
+		free(line);
+	}
+
+	if (UNLIKELY(build(fn) < 0)) {
+		fprintf(stderr, "\
+Error: cannot write index file `%s': %s\n", fn, strerror(errno));
+		rc = 1;
+	}
+	free(nods);
+	free(pool);
+	return rc;
+}
+
+static int
+cmd_stab(const yuck_t argi[static 1U])
+{
+	const char *fn;
+	int rc = 0;
+
+	if (argi->nargs < 1U) {
+		yuck_auto_help(argi);
+		return 1;
+	}
+	fn = argi->args[0U];
+
+	if (UNLIKELY(itree_open(fn) < 0)) {
+		fprintf(stderr, "\
+Error: cannot open index file `%s'", fn);
+		if (errno) {
+			fprintf(stderr, ": %s", strerror(errno));
+		}
+		fputc('\n', stderr);
+		return 1;
+	}
+
+	/* tell apart results of several instants */
+	qno = argi->nargs != 2U;
+	for (size_t i = 1U; i < argi->nargs; i++, qno += qno > 0U) {
+		const char *s = argi->args[i];
+
+		if (UNLIKELY(stab_ln(s, strlen(s)) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse instant `%s'\n", s);
+			rc = 1;
+		}
+	}
+	if (argi->nargs == 1U) {
+		char *line = NULL;
+		size_t llen = 0U;
+		size_t nln = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			nln++;
+			qno = nln;
+			if (UNLIKELY(stab_ln(line, nrd) < 0)) {
+				fprintf(stderr, "\
+Warning: cannot parse instant on line %zu\n", nln);
+				rc = 1;
+			}
+		}
+		free(line);
+	}
+	itree_close();
+	return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	switch (argi->cmd) {
+	case TBOX_ITREE_CMD_BUILD:
+		rc = cmd_build(argi);
+		break;
+	case TBOX_ITREE_CMD_STAB:
+		rc = cmd_stab(argi);
+		break;
+	default:
+		yuck_auto_help(argi);
+		rc = 1;
+		break;
+	}
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* tbox-itree.c ends here */
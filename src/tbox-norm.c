@@ -44,31 +44,27 @@
 #include <math.h>
 #include <time.h>
 #include "dt-strpf.h"
+#include "cols.h"
 #include "nifty.h"
 
 
+static cols_t cols[1U] = {{.sep = '\t'}};
+
 static int
-norm_ln(const char *wkt, size_t len)
+norm_rngs(const char *wkt, size_t len, size_t *eop, const char *pre)
 {
+/* print the normalised ranges of WKT, PRE before them, and set EOP
+ * to where parsing stopped, nothing is printed if none parse */
 	echs_range_t last;
 	size_t zpre = 0U;
 	size_t wi = 0U;
-	int rc = 0;
-
-	/* allow prefixes */
-	with (const char *wp = memchr(wkt, '\t', len)) {
-		if (wp != NULL) {
-			wi += ++wp - wkt;
-			fwrite(wkt, 1, wi, stdout);
-		}
-	}
 
 	/* read first interval to set up state */
 	with (char *eo = NULL) {
-		last = range_strp(wkt + wi, &eo, len - wi);
+		last = range_strp(wkt, &eo, len);
 		if (UNLIKELY(eo == NULL)) {
-			rc = -1;
-			goto oh;
+			*eop = 0U;
+			return -1;
 		}
 		/* unfix him */
 		last = echs_range_unfix(last);
@@ -76,6 +72,7 @@ norm_ln(const char *wkt, size_t len)
 		wi = eo - wkt;
 		for (; wi < len && isspace(wkt[wi]); wi++);
 	}
+	fputs(pre, stdout);
 
 	while (wi < len) {
 		char *eo = NULL;
@@ -117,8 +114,28 @@ norm_ln(const char *wkt, size_t len)
 		z += range_strf(buf + z, sizeof(buf) - z, last);
 		fwrite(buf, 1, z, stdout);
 	}
+	*eop = wi;
+	return 0;
+}
+
+static int
+norm_ln(const char *wkt, size_t len)
+{
+	size_t wi = 0U;
+	size_t eo;
+	int rc;
+
+	/* allow prefixes */
+	with (const char *wp = memchr(wkt, '\t', len)) {
+		if (wp != NULL) {
+			wi += ++wp - wkt;
+			fwrite(wkt, 1, wi, stdout);
+		}
+	}
+
+	rc = norm_rngs(wkt + wi, len - wi, &eo, "");
+	wi += eo;
 
-oh:
 	/* finalise the line */
 	if (wi < len) {
 		fwrite(wkt + wi, 1, len - wi, stdout);
@@ -128,6 +145,47 @@ oh:
 	return rc;
 }
 
+static int
+norm_cols(const char *ln, size_t len)
+{
+/* normalise picked columns in place, pass on the rest */
+	size_t ez = 0U;
+	size_t i = 0U;
+	int rc = 0;
+
+	/* line endings are kept */
+	ez += len > ez && ln[len - ez - 1U] == '\n';
+	ez += ez && len > ez && ln[len - ez - 1U] == '\r';
+	for (const char *sp = ln, *const ep = ln + len - ez, *fp;
+	     sp <= ep; sp = fp + 1U, i++) {
+		/* results have spaces, and commas */
+		const bool qp = (sp < ep && *sp == '"') || cols->sep == ',';
+		const char *s;
+		size_t n, eo;
+
+		fp = cols_fend(cols, sp, ep);
+		if (i) {
+			fputc(cols->sep, stdout);
+		}
+		if (!cols_pick_p(cols, i) || sp == fp) {
+			fwrite(sp, 1, fp - sp, stdout);
+			continue;
+		}
+		s = cols_field(cols, &n, sp, fp - sp);
+		if (UNLIKELY(norm_rngs(s, n, &eo, qp ? "\"" : "") < 0)) {
+			fwrite(sp, 1, fp - sp, stdout);
+			rc = -1;
+			continue;
+		}
+		fwrite(s + eo, 1, n - eo, stdout);
+		if (qp) {
+			fputc('"', stdout);
+		}
+	}
+	fwrite(ln + len - ez, 1, ez, stdout);
+	return rc;
+}
+
 
 #include "tbox-norm.yucc"
 
@@ -142,13 +200,39 @@ main(int argc, char *argv[])
 		goto out;
 	}
 
-	if (!argi->nargs) {
+	if (argi->csv_flag) {
+		cols->sep = ',';
+	}
+	if (argi->columns_arg &&
+	    UNLIKELY(cols_strp(cols, argi->columns_arg) < 0)) {
+		fprintf(stderr, "\
+Error: cannot parse columns `%s'\n", argi->columns_arg);
+		rc = 1;
+		goto out;
+	}
+
+	if (!argi->nargs && argi->columns_arg) {
+		char *line = NULL;
+		size_t llen = 0U;
+		ssize_t nrd;
+
+		if (argi->header_flag &&
+		    (nrd = cols_getrec(cols, &line, &llen, stdin)) > 0) {
+			fwrite(line, 1, nrd, stdout);
+		}
+		while ((nrd = cols_getrec(cols, &line, &llen, stdin)) > 0) {
+			rc |= norm_cols(line, nrd) < 0;
+		}
+		free(line);
+		cols_fini(cols);
+	} else if (!argi->nargs) {
 		char *line = NULL;
 		size_t llen = 0U;
 
 		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
 			rc |= norm_ln(line, nrd) < 0;
 		}
+		free(line);
 	}
 
 out:
@@ -0,0 +1,746 @@
+/*** tbox-rtree.c -- packed R-trees over bitemporal boxes
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dt-strpf.h"
+#include "box.h"
+#include "nifty.h"
+
+/* the on-disk tree, all values in native byte order,
+ * the header is followed by
+ * - the boxes of all levels, leaves (the entries) first, root last
+ * - for every entry the offset of its key in the key pool
+ * - the key pool, nul-terminated strings
+ * children of node I on level L > 0 are nodes I * FANOUT up to
+ * (I + 1) * FANOUT - 1 on level L - 1 */
+#define MAX_NLVL	(64U)
+
+/* the mapping of time onto boxes, see echs_boxmap_t, without padding
+ * so that mappings can be compared bytewise */
+typedef struct {
+	uint64_t epoch[3U];
+	int32_t scale[3U];
+	uint32_t warp;
+	uint32_t nknot;
+	uint32_t pad;
+	uint64_t knot[MAX_BOXWARP_KNOTS];
+	double slope[MAX_BOXWARP_KNOTS];
+} rtmap_t;
+
+typedef struct {
+	char magic[8U];
+	uint32_t fanout;
+	uint32_t nlvl;
+	/* number of entries, i.e. leaves */
+	uint64_t nent;
+	/* index of the first box of each level, LVL[NLVL] is the total */
+	uint64_t lvl[MAX_NLVL + 1U];
+	/* size of the key pool */
+	uint64_t poolz;
+	/* the mapping the boxes were made with */
+	rtmap_t map;
+} rtree_t;
+
+static const char rtree_magic[8U] = "tboxrtr2";
+
+static rtmap_t
+rtmap(echs_boxmap_t m)
+{
+	rtmap_t r;
+
+	memset(&r, 0, sizeof(r));
+	for (size_t i = 0U; i < countof(r.epoch); i++) {
+		r.epoch[i] = m.epoch[i].u;
+		r.scale[i] = m.scale[i];
+	}
+	r.warp = m.warp.type;
+	r.nknot = m.warp.nknot;
+	for (size_t i = 0U; i < m.warp.nknot; i++) {
+		r.knot[i] = m.warp.knot[i].u;
+		r.slope[i] = m.warp.slope[i];
+	}
+	return r;
+}
+
+static echs_boxmap_t
+boxmap(rtmap_t r)
+{
+	echs_boxmap_t m = echs_box_defmap;
+
+	for (size_t i = 0U; i < countof(r.epoch); i++) {
+		m.epoch[i].u = r.epoch[i];
+		m.scale[i] = r.scale[i];
+	}
+	m.warp.type = r.warp;
+	m.warp.nknot = r.nknot;
+	for (size_t i = 0U; i < r.nknot; i++) {
+		m.warp.knot[i].u = r.knot[i];
+		m.warp.slope[i] = r.slope[i];
+	}
+	return m;
+}
+
+typedef enum {
+	REL_INTERSECTS,
+	REL_WITHIN,
+	REL_CONTAINS,
+} rel_t;
+
+
+/* builder */
+static echs_box_t *boxs;
+static uint64_t *koffs;
+static size_t nent;
+static size_t zent;
+
+static char *pool;
+static size_t poolz;
+static size_t poolp;
+
+static int
+push_key(const char *key, size_t len)
+{
+	if (UNLIKELY(poolp + len + 1U > poolz)) {
+		size_t nuz = (poolz * 2U) ?: 65536U;
+		char *nu;
+
+		for (; nuz < poolp + len + 1U; nuz *= 2U);
+		if (UNLIKELY((nu = realloc(pool, nuz)) == NULL)) {
+			return -1;
+		}
+		pool = nu;
+		poolz = nuz;
+	}
+	memcpy(pool + poolp, key, len);
+	pool[poolp + len] = '\0';
+	poolp += len + 1U;
+	return 0;
+}
+
+static int
+push_box(echs_box_t b, uint64_t koff)
+{
+	if (UNLIKELY(nent >= zent)) {
+		const size_t nuz = (zent * 2U) ?: 4096U;
+		echs_box_t *nb = realloc(boxs, nuz * sizeof(*boxs));
+		uint64_t *nk;
+
+		if (UNLIKELY(nb == NULL)) {
+			return -1;
+		}
+		boxs = nb;
+		if (UNLIKELY((nk = realloc(koffs, nuz * sizeof(*koffs))) == NULL)) {
+			return -1;
+		}
+		koffs = nk;
+		zent = nuz;
+	}
+	boxs[nent] = b;
+	koffs[nent] = koff;
+	nent++;
+	return 0;
+}
+
+static int
+build_ln(const char *ln, size_t len)
+{
+	static const char col[] = "GEOMETRYCOLLECTION";
+	const uint64_t koff = poolp;
+	size_t nbox = 0U;
+	size_t wi = 0U;
+
+	/* the prefix is the key */
+	with (const char *wp = memchr(ln, '\t', len)) {
+		if (wp != NULL) {
+			wi = wp - ln;
+		}
+		if (UNLIKELY(push_key(ln, wi) < 0)) {
+			return -1;
+		}
+		wi += wp != NULL;
+	}
+	/* only index the first geometry, e.g. t2geo --simplify coverings */
+	with (const char *tp = memchr(ln + wi, '\t', len - wi)) {
+		if (tp != NULL) {
+			len = tp - ln;
+		}
+	}
+
+	if (wi + strlenof(col) < len && !memcmp(ln + wi, col, strlenof(col))) {
+		if (UNLIKELY(ln[wi += strlenof(col)] != '(')) {
+			return -1;
+		}
+		wi++;
+	}
+	/* read boxes */
+	while (wi < len) {
+		echs_box_t b;
+		char *eo = NULL;
+
+		/* overread whitespace, commas and nested collections */
+		for (; wi < len &&
+			     (isspace(ln[wi]) || ln[wi] == ',' || ln[wi] == ')');
+		     wi++);
+		if (wi + strlenof(col) < len &&
+		    !memcmp(ln + wi, col, strlenof(col)) &&
+		    ln[wi + strlenof(col)] == '(') {
+			/* the pieces of t2geo --slab */
+			wi += strlenof(col) + 1U;
+			continue;
+		} else if (wi >= len) {
+			break;
+		}
+		b = box_strp(ln + wi, &eo, len - wi);
+		if (UNLIKELY(eo == NULL)) {
+			return -1;
+		} else if (UNLIKELY(push_box(b, koff) < 0)) {
+			return -1;
+		}
+		wi = eo - ln;
+		nbox++;
+	}
+	if (UNLIKELY(!nbox)) {
+		/* retract the key again */
+		poolp = koff;
+	}
+	return 0;
+}
+
+typedef struct {
+	uint64_t h;
+	size_t i;
+} hidx_t;
+
+static int
+hidx_cmp(const void *a, const void *b)
+{
+	const hidx_t *x = a;
+	const hidx_t *y = b;
+	return (x->h > y->h) - (x->h < y->h) ?: (x->i > y->i) - (x->i < y->i);
+}
+
+static int
+build(const char *fn, unsigned int fanout)
+{
+	rtree_t hdr = {
+		.fanout = fanout, .nent = nent, .poolz = poolp,
+		.map = rtmap(echs_box_getmap()),
+	};
+	echs_box_t *tree;
+	uint64_t *ks;
+	FILE *fp;
+	int rc = 0;
+
+	memcpy(hdr.magic, rtree_magic, sizeof(rtree_magic));
+	/* level sizes */
+	hdr.lvl[0U] = 0U;
+	if (nent) {
+		uint64_t n = nent;
+
+		hdr.lvl[hdr.nlvl = 1U] = n;
+		while (n > 1U) {
+			n = (n + fanout - 1U) / fanout;
+			hdr.lvl[hdr.nlvl + 1U] = hdr.lvl[hdr.nlvl] + n;
+			hdr.nlvl++;
+		}
+	}
+	if (UNLIKELY((tree = malloc(hdr.lvl[hdr.nlvl] * sizeof(*tree) + 1U)) == NULL)) {
+		return -1;
+	} else if (UNLIKELY((ks = malloc(nent * sizeof(*ks) + 1U)) == NULL)) {
+		free(tree);
+		return -1;
+	}
+
+	/* pack leaves along the Hilbert curve */
+	with (hidx_t *hi = malloc(nent * sizeof(*hi) + 1U)) {
+		if (UNLIKELY(hi == NULL)) {
+			rc = -1;
+			goto out;
+		}
+		for (size_t i = 0U; i < nent; i++) {
+			hi[i] = (hidx_t){echs_box_hilbert(boxs[i]), i};
+		}
+		qsort(hi, nent, sizeof(*hi), hidx_cmp);
+		for (size_t i = 0U; i < nent; i++) {
+			tree[i] = boxs[hi[i].i];
+			ks[i] = koffs[hi[i].i];
+		}
+		free(hi);
+	}
+	/* and bottom-up the nodes */
+	for (size_t l = 1U; l < hdr.nlvl; l++) {
+		const uint64_t cb = hdr.lvl[l - 1U];
+		const uint64_t ce = hdr.lvl[l];
+
+		for (uint64_t i = hdr.lvl[l], c = cb; c < ce; i++) {
+			const uint64_t e = c + fanout < ce ? c + fanout : ce;
+
+			tree[i] = tree[c];
+			for (c++; c < e; c++) {
+				tree[i] = echs_box_union(tree[i], tree[c]);
+			}
+		}
+	}
+
+	if (UNLIKELY((fp = fopen(fn, "wb")) == NULL)) {
+		rc = -1;
+		goto out;
+	}
+	fwrite(&hdr, sizeof(hdr), 1U, fp);
+	fwrite(tree, sizeof(*tree), hdr.lvl[hdr.nlvl], fp);
+	fwrite(ks, sizeof(*ks), nent, fp);
+	fwrite(pool, 1, poolp, fp);
+	if (UNLIKELY(ferror(fp))) {
+		rc = -1;
+	}
+	rc |= -(fclose(fp) < 0);
+out:
+	free(tree);
+	free(ks);
+	return rc;
+}
+
+
+
+/* querying */
+static const rtree_t *rt;
+static size_t rtz;
+static const echs_box_t *rtbox;
+static const uint64_t *rtkey;
+static const char *rtpool;
+/* number of the current query, 0 if results aren't numbered */
+static size_t qno;
+
+static int
+rtree_open(const char *fn)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) {
+		return -1;
+	} else if (fstat(fd, &st) < 0) {
+		goto clo;
+	} else if ((size_t)st.st_size < sizeof(*rt)) {
+		errno = 0;
+		goto clo;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		goto clo;
+	}
+	rt = p;
+	rtz = st.st_size;
+	if (memcmp(rt->magic, rtree_magic, sizeof(rtree_magic)) ||
+	    rt->nlvl > MAX_NLVL || rt->map.nknot > MAX_BOXWARP_KNOTS ||
+	    sizeof(*rt) + rt->lvl[rt->nlvl] * sizeof(*rtbox) +
+	    rt->nent * sizeof(*rtkey) + rt->poolz != rtz) {
+		munmap(p, rtz);
+		rt = NULL;
+		errno = 0;
+		goto clo;
+	}
+	rtbox = (const void*)(rt + 1U);
+	rtkey = (const void*)(rtbox + rt->lvl[rt->nlvl]);
+	rtpool = (const void*)(rtkey + rt->nent);
+	close(fd);
+	return 0;
+
+clo:
+	close(fd);
+	return -1;
+}
+
+static void
+rtree_close(void)
+{
+	if (rt != NULL) {
+		munmap(deconst(rt), rtz);
+		rt = NULL;
+	}
+	return;
+}
+
+static inline bool
+node_p(echs_box_t node, echs_box_t q, rel_t rel)
+{
+	switch (rel) {
+	default:
+	case REL_INTERSECTS:
+		/* closed like sfIntersects, queries clamped to the
+		 * edge must still meet boxes open towards it */
+		return echs_box_touches_p(node, q);
+	case REL_WITHIN:
+		return echs_box_touches_p(node, q);
+	case REL_CONTAINS:
+		return echs_box_contains_p(node, q);
+	}
+}
+
+static inline bool
+leaf_p(echs_box_t leaf, echs_box_t q, rel_t rel)
+{
+	switch (rel) {
+	default:
+	case REL_INTERSECTS:
+		return echs_box_touches_p(leaf, q);
+	case REL_WITHIN:
+		return echs_box_contains_p(q, leaf);
+	case REL_CONTAINS:
+		return echs_box_contains_p(leaf, q);
+	}
+}
+
+static size_t
+query(echs_box_t q, rel_t rel)
+{
+	/* explicit stack of (level, node) pairs, at most FANOUT per level */
+	struct {
+		uint32_t l;
+		uint64_t i;
+	} *stk;
+	size_t nstk = 0U;
+	size_t nres = 0U;
+
+	if (UNLIKELY(!rt->nlvl)) {
+		return 0U;
+	}
+	stk = malloc(rt->nlvl * rt->fanout * sizeof(*stk));
+	if (UNLIKELY(stk == NULL)) {
+		return 0U;
+	}
+	stk[nstk++] = (__typeof__(*stk)){rt->nlvl - 1U, 0U};
+	while (nstk) {
+		const uint32_t l = stk[--nstk].l;
+		const uint64_t i = stk[nstk].i;
+		const echs_box_t b = rtbox[rt->lvl[l] + i];
+
+		if (l) {
+			const uint64_t nc = rt->lvl[l] - rt->lvl[l - 1U];
+			uint64_t c = i * rt->fanout;
+			uint64_t e = c + rt->fanout < nc ? c + rt->fanout : nc;
+
+			if (!node_p(b, q, rel)) {
+				continue;
+			}
+			/* push in reverse so we visit children in order */
+			while (e-- > c) {
+				stk[nstk++] = (__typeof__(*stk)){l - 1U, e};
+			}
+		} else if (leaf_p(b, q, rel)) {
+			const char *key = rtpool + rtkey[i];
+			char buf[256U];
+			size_t z;
+
+			if (qno) {
+				printf("%zu\t", qno);
+			}
+			if (*key) {
+				fputs(key, stdout);
+				fputc('\t', stdout);
+			}
+			z = box_strf(buf, sizeof(buf), b);
+			buf[z++] = '\n';
+			fwrite(buf, 1, z, stdout);
+			nres++;
+		}
+	}
+	free(stk);
+	return nres;
+}
+
+static echs_range_t
+dim_strp(const char *str, char **on, size_t len)
+{
+/* ranges as usual, instants I become [I, I + 1ms) */
+	char *eo = NULL;
+	echs_range_t r = range_strp(str, &eo, len);
+	echs_instant_t i;
+
+	if (eo != NULL) {
+		*on = eo;
+		return r;
+	}
+	i = dt_strp(str, on, len);
+	if (UNLIKELY(*on == NULL || *on == str)) {
+		*on = NULL;
+		return echs_max_range();
+	}
+	if (echs_instant_all_day_p(i)) {
+		i.H = 0, i.M = 0, i.S = 0, i.ms = 0;
+	} else if (echs_instant_all_sec_p(i)) {
+		i.ms = 0;
+	}
+	return (echs_range_t){i, echs_instant_add(i, (echs_idiff_t){0, 1U})};
+}
+
+static int
+query_ln(const char *ln, size_t len, rel_t rel)
+{
+	echs_range_t r[2U];
+	size_t wi = 0U;
+	char *eo = NULL;
+
+	for (; wi < len && isspace(ln[wi]); wi++);
+	r[0U] = dim_strp(ln + wi, &eo, len - wi);
+	if (UNLIKELY(eo == NULL)) {
+		return -1;
+	}
+	wi = eo - ln;
+	r[1U] = echs_max_range();
+	for (; wi < len && isspace(ln[wi]); wi++);
+	if (wi < len && ln[wi] == ',') {
+		for (wi++; wi < len && isspace(ln[wi]); wi++);
+		eo = NULL;
+		r[1U] = dim_strp(ln + wi, &eo, len - wi);
+		if (UNLIKELY(eo == NULL)) {
+			return -1;
+		}
+		wi = eo - ln;
+	}
+	for (; wi < len && isspace(ln[wi]); wi++);
+	if (UNLIKELY(wi < len)) {
+		return -1;
+	}
+	query(echs_range_box(r[0U], r[1U]), rel);
+	return 0;
+}
+
+
+
+#include "tbox-rtree.yucc"
+
+static int
+cmd_build(const yuck_t argi[static 1U])
+{
+	const char *fn;
+	unsigned long int fanout = 16U;
+	int rc = 0;
+
+	if (argi->nargs != 1U) {
+		yuck_auto_help(argi);
+		return 1;
+	}
+	fn = argi->args[0U];
+	with (echs_boxmap_t m = echs_box_defmap) {
+		if (UNLIKELY(echs_boxmap_strp(
+				     &m, argi->build.epoch_arg,
+				     argi->build.scale_arg,
+				     argi->build.warp_arg) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse epoch, scale or warp\n");
+			return 1;
+		}
+		echs_box_setmap(m);
+	}
+	if (argi->build.fanout_arg) {
+		char *on = NULL;
+
+		fanout = strtoul(argi->build.fanout_arg, &on, 10);
+		if (UNLIKELY(on == NULL || *on || fanout < 2U || fanout > 65536U)) {
+			fprintf(stderr, "\
+Error: fanout must be between 2 and 65536\n");
+			return 1;
+		}
+	}
+
+	{
+		char *line = NULL;
+		size_t llen = 0U;
+		size_t nln = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			nln++;
+			if (LIKELY(line[nrd - 1U] == '\n')) {
+				nrd--;
+			}
+			if (UNLIKELY(build_ln(line, nrd) < 0)) {
+				fprintf(stderr, "\
+Warning: cannot process line %zu\n", nln);
+				rc = 1;
+			}
+		}
+		free(line);
+	}
+
+	if (UNLIKELY(build(fn, fanout) < 0)) {
+		fprintf(stderr, "\
+Error: cannot write index file `%s': %s\n", fn, strerror(errno));
+		rc = 1;
+	}
+	free(boxs);
+	free(koffs);
+	free(pool);
+	return rc;
+}
+
+static int
+cmd_query(const yuck_t argi[static 1U])
+{
+	static const char *const rels[] = {
+		[REL_INTERSECTS] = "intersects",
+		[REL_WITHIN] = "within",
+		[REL_CONTAINS] = "contains",
+	};
+	rel_t rel = REL_INTERSECTS;
+	const char *fn;
+	int rc = 0;
+
+	if (argi->nargs < 1U) {
+		yuck_auto_help(argi);
+		return 1;
+	}
+	fn = argi->args[0U];
+	if (argi->query.relation_arg) {
+		size_t i;
+
+		for (i = 0U; i < countof(rels) &&
+			     strcmp(argi->query.relation_arg, rels[i]); i++);
+		if (UNLIKELY(i >= countof(rels))) {
+			fprintf(stderr, "\
+Error: unknown relation `%s'\n", argi->query.relation_arg);
+			return 1;
+		}
+		rel = (rel_t)i;
+	}
+
+	if (UNLIKELY(rtree_open(fn) < 0)) {
+		fprintf(stderr, "\
+Error: cannot open index file `%s'", fn);
+		if (errno) {
+			fprintf(stderr, ": %s", strerror(errno));
+		}
+		fputc('\n', stderr);
+		return 1;
+	}
+	/* queries are mapped like the index, given mappings must agree */
+	with (echs_boxmap_t m = boxmap(rt->map)) {
+		rtmap_t r;
+
+		if (UNLIKELY(echs_boxmap_strp(
+				     &m, argi->query.epoch_arg,
+				     argi->query.scale_arg,
+				     argi->query.warp_arg) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse epoch, scale or warp\n");
+			rtree_close();
+			return 1;
+		} else if (UNLIKELY((r = rtmap(m),
+				     memcmp(&r, &rt->map, sizeof(r))))) {
+			fprintf(stderr, "\
+Error: mapping differs from the one of index file `%s'\n", fn);
+			rtree_close();
+			return 1;
+		}
+		echs_box_setmap(m);
+	}
+
+	/* tell apart results of several queries */
+	qno = argi->nargs != 2U;
+	for (size_t i = 1U; i < argi->nargs; i++, qno += qno > 0U) {
+		const char *q = argi->args[i];
+
+		if (UNLIKELY(query_ln(q, strlen(q), rel) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse query `%s'\n", q);
+			rc = 1;
+		}
+	}
+	if (argi->nargs == 1U) {
+		char *line = NULL;
+		size_t llen = 0U;
+		size_t nln = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			nln++;
+			if (LIKELY(line[nrd - 1U] == '\n')) {
+				nrd--;
+			}
+			qno = nln;
+			if (UNLIKELY(query_ln(line, nrd, rel) < 0)) {
+				fprintf(stderr, "\
+Warning: cannot parse query on line %zu\n", nln);
+				rc = 1;
+			}
+		}
+		free(line);
+	}
+	rtree_close();
+	return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	switch (argi->cmd) {
+	case TBOX_RTREE_CMD_BUILD:
+		rc = cmd_build(argi);
+		break;
+	case TBOX_RTREE_CMD_QUERY:
+		rc = cmd_query(argi);
+		break;
+	default:
+		yuck_auto_help(argi);
+		rc = 1;
+		break;
+	}
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* tbox-rtree.c ends here */
@@ -0,0 +1,467 @@
+/*** tbox-scd.c -- slowly changing dimensions with system-time closing
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dt-strpf.h"
+#include "nifty.h"
+
+/* the on-disk hash table, open addressing with linear probing,
+ * all values in native byte order, keys are kept in their slots so
+ * hash collisions can be told apart, which caps their length */
+#define KEY_MAX		(88U)
+
+typedef struct {
+	/* key hash, 0 denotes an empty slot */
+	uint64_t k;
+	/* the current version */
+	echs_range_t val;
+	echs_instant_t sys;
+	/* the key itself */
+	uint64_t kz;
+	char key[KEY_MAX];
+} slot_t;
+
+typedef struct {
+	char magic[8U];
+	/* number of slots, a power of 2 */
+	uint64_t nslots;
+	/* number of occupied slots */
+	uint64_t nused;
+	uint64_t pad;
+	slot_t slots[];
+} htab_t;
+
+static const char scd_magic[8U] = "tboxscd2";
+#define INI_NSLOTS	(1024U)
+
+static htab_t *ht;
+static int htfd = -1;
+static const char *htfn;
+static echs_instant_t now;
+static unsigned int dryp;
+
+
+static uint64_t
+hash(const char *key, size_t len)
+{
+/* FNV-1a, 0 is reserved for empty slots */
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0U; i < len; i++) {
+		h ^= (unsigned char)key[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h ?: 1U;
+}
+
+static size_t
+htab_size(uint64_t nslots)
+{
+	return sizeof(htab_t) + nslots * sizeof(slot_t);
+}
+
+static htab_t*
+htab_map(int fd, size_t z)
+{
+	void *p;
+
+	p = mmap(NULL, z, PROT_READ | PROT_WRITE,
+		 dryp ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+	return p != MAP_FAILED ? p : NULL;
+}
+
+static int
+htab_open(const char *fn)
+{
+	struct stat st;
+	int fd;
+
+	if (dryp) {
+		/* leave STATE alone, not even create it */
+		if ((fd = open(fn, O_RDONLY)) < 0 && errno != ENOENT) {
+			return -1;
+		} else if (fd >= 0 && fstat(fd, &st) < 0) {
+			goto clo;
+		} else if (fd < 0 || !st.st_size) {
+			/* fresh table, in memory only */
+			ht = mmap(NULL, htab_size(INI_NSLOTS),
+				  PROT_READ | PROT_WRITE,
+				  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (ht == MAP_FAILED) {
+				ht = NULL;
+				goto clo;
+			}
+			memcpy(ht->magic, scd_magic, sizeof(scd_magic));
+			ht->nslots = INI_NSLOTS;
+			ht->nused = 0U;
+			if (fd >= 0) {
+				close(fd);
+			}
+			return 0;
+		}
+	} else if ((fd = open(fn, O_RDWR | O_CREAT, 0644)) < 0) {
+		return -1;
+	} else if (fstat(fd, &st) < 0) {
+		goto clo;
+	}
+
+	if (!st.st_size) {
+		/* fresh table */
+		if (ftruncate(fd, htab_size(INI_NSLOTS)) < 0) {
+			goto clo;
+		} else if ((ht = htab_map(fd, htab_size(INI_NSLOTS))) == NULL) {
+			goto clo;
+		}
+		memcpy(ht->magic, scd_magic, sizeof(scd_magic));
+		ht->nslots = INI_NSLOTS;
+		ht->nused = 0U;
+	} else if ((size_t)st.st_size < sizeof(htab_t)) {
+		errno = 0;
+		goto clo;
+	} else if ((ht = htab_map(fd, st.st_size)) == NULL) {
+		goto clo;
+	} else if (memcmp(ht->magic, scd_magic, sizeof(scd_magic)) ||
+		   htab_size(ht->nslots) != (size_t)st.st_size) {
+		munmap(ht, st.st_size);
+		ht = NULL;
+		errno = 0;
+		goto clo;
+	}
+	htfd = fd;
+	return 0;
+
+clo:
+	save_errno {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+	return -1;
+}
+
+static void
+htab_close(void)
+{
+	if (ht != NULL) {
+		munmap(ht, htab_size(ht->nslots));
+		ht = NULL;
+	}
+	if (htfd >= 0) {
+		close(htfd);
+		htfd = -1;
+	}
+	return;
+}
+
+static slot_t*
+htab_find(const htab_t *h, uint64_t k, const char *key, size_t kz)
+{
+	const uint64_t msk = h->nslots - 1U;
+
+	for (uint64_t i = k & msk;; i = (i + 1U) & msk) {
+		const slot_t *s = h->slots + i;
+
+		if (!s->k) {
+			return deconst(s);
+		} else if (s->k == k && s->kz == kz &&
+			   !memcmp(s->key, key, kz)) {
+			return deconst(s);
+		}
+	}
+	/* not reached */
+}
+
+static int
+htab_grow(void)
+{
+/* rehash into a table twice the size, we go through a temp file so
+ * that a crash mid-way leaves the old table intact */
+	const uint64_t nslots = ht->nslots * 2U;
+	char tmpfn[strlen(htfn) + 5U];
+	htab_t *nu;
+	int fd;
+
+	if (dryp) {
+		/* private mapping, just make a fresh anonymous one */
+		nu = mmap(NULL, htab_size(nslots), PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		fd = -1;
+		if (nu == MAP_FAILED) {
+			return -1;
+		}
+		goto rehash;
+	}
+	memcpy(tmpfn, htfn, sizeof(tmpfn) - 5U);
+	memcpy(tmpfn + sizeof(tmpfn) - 5U, ".tmp", 5U);
+	if ((fd = open(tmpfn, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+		return -1;
+	} else if (ftruncate(fd, htab_size(nslots)) < 0) {
+		goto clo;
+	} else if ((nu = htab_map(fd, htab_size(nslots))) == NULL) {
+		goto clo;
+	}
+
+rehash:
+	memcpy(nu->magic, scd_magic, sizeof(scd_magic));
+	nu->nslots = nslots;
+	nu->nused = ht->nused;
+	for (uint64_t i = 0U; i < ht->nslots; i++) {
+		if (ht->slots[i].k) {
+			const slot_t *s = ht->slots + i;
+
+			*htab_find(nu, s->k, s->key, s->kz) = *s;
+		}
+	}
+	/* the new table must be on disk before it replaces the old one */
+	if (fd >= 0 &&
+	    (msync(nu, htab_size(nslots), MS_SYNC) < 0 || fsync(fd) < 0 ||
+	     rename(tmpfn, htfn) < 0)) {
+		munmap(nu, htab_size(nslots));
+		goto clo;
+	}
+	htab_close();
+	ht = nu;
+	htfd = fd;
+	return 0;
+
+clo:
+	save_errno {
+		close(fd);
+		unlink(tmpfn);
+	}
+	return -1;
+}
+
+static void
+htab_del(slot_t *s)
+{
+/* backward shift deletion, keeps probe sequences intact */
+	const uint64_t msk = ht->nslots - 1U;
+	uint64_t i = s - ht->slots;
+
+	for (uint64_t j = (i + 1U) & msk; ht->slots[j].k; j = (j + 1U) & msk) {
+		uint64_t home = ht->slots[j].k & msk;
+
+		/* can slot J move to I, i.e. is HOME not in (I, J] */
+		if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+			ht->slots[i] = ht->slots[j];
+			i = j;
+		}
+	}
+	ht->slots[i].k = 0U;
+	ht->nused--;
+	return;
+}
+
+
+static void
+prnt_version(
+	const char *key, size_t kz, echs_range_t val, echs_range_t sys)
+{
+	char buf[256U];
+	size_t z;
+
+	/* system ranges come unfixed */
+	sys = echs_range_fixup(sys);
+	z = range_strf(buf, sizeof(buf), val);
+	buf[z++] = ',';
+	buf[z++] = ' ';
+	z += range_strf(buf + z, sizeof(buf) - z, sys);
+	buf[z++] = '\n';
+	fwrite(key, 1, kz, stdout);
+	fputc('\t', stdout);
+	fwrite(buf, 1, z, stdout);
+	return;
+}
+
+static int
+scd_ln(const char *ln, size_t len)
+{
+	const char *tp;
+	echs_range_t val;
+	uint64_t k;
+	size_t kz;
+	slot_t *s;
+
+	if (UNLIKELY((tp = memchr(ln, '\t', len)) == NULL)) {
+		return -1;
+	} else if (UNLIKELY((kz = tp - ln) > KEY_MAX)) {
+		/* won't fit */
+		return -1;
+	}
+	len -= ++tp - ln;
+	for (; len && isspace(*tp); tp++, len--);
+	for (; len && isspace(tp[len - 1U]); len--);
+
+	if (!len) {
+		/* retraction */
+		val = echs_nul_range();
+	} else {
+		char *on = NULL;
+
+		val = range_strp(tp, &on, len);
+		if (UNLIKELY(on == NULL || on < tp + len)) {
+			return -1;
+		}
+	}
+
+	k = hash(ln, kz);
+	s = htab_find(ht, k, ln, kz);
+	if (!s->k) {
+		/* new key */
+		if (echs_nul_range_p(val)) {
+			return 0;
+		}
+		prnt_version(ln, kz, val, (echs_range_t){now, echs_max_instant()});
+		if (UNLIKELY(2U * (ht->nused + 1U) > ht->nslots)) {
+			if (htab_grow() < 0) {
+				return -1;
+			}
+			s = htab_find(ht, k, ln, kz);
+		}
+		*s = (slot_t){.k = k, .val = val, .sys = now, .kz = kz};
+		memcpy(s->key, ln, kz);
+		ht->nused++;
+		return 0;
+	} else if (!echs_nul_range_p(val) &&
+		   echs_range_equals_p(val, s->val)) {
+		/* nothing's changed */
+		return 0;
+	} else if (UNLIKELY(!echs_instant_lt_p(s->sys, now))) {
+		/* can't close a version that's younger than NOW */
+		return -1;
+	}
+	/* close the current version */
+	prnt_version(ln, kz, s->val, (echs_range_t){s->sys, now});
+	if (echs_nul_range_p(val)) {
+		htab_del(s);
+		return 0;
+	}
+	/* and open a new one */
+	prnt_version(ln, kz, val, (echs_range_t){now, echs_max_instant()});
+	s->val = val;
+	s->sys = now;
+	return 0;
+}
+
+
+#include "tbox-scd.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	} else if (argi->nargs != 1U) {
+		yuck_auto_help(argi);
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->system_arg) {
+		const char *s = argi->system_arg;
+		char *on = NULL;
+
+		now = dt_strp(s, &on, strlen(s));
+		if (UNLIKELY(on == NULL || *on)) {
+			fprintf(stderr, "\
+Error: cannot parse system time `%s'\n", s);
+			rc = 1;
+			goto out;
+		}
+		/* unfix him, we keep exact system times in STATE */
+		if (echs_instant_all_day_p(now)) {
+			now.H = 0, now.M = 0, now.S = 0, now.ms = 0;
+		} else if (echs_instant_all_sec_p(now)) {
+			now.ms = 0;
+		}
+	} else {
+		now = epoch_to_echs_instant(time(NULL));
+	}
+	dryp = argi->dry_run_flag;
+
+	if (htab_open(htfn = argi->args[0U]) < 0) {
+		fprintf(stderr, "\
+Error: cannot open state file `%s'", htfn);
+		if (errno) {
+			fprintf(stderr, ": %s", strerror(errno));
+		}
+		fputc('\n', stderr);
+		rc = 1;
+		goto out;
+	}
+
+	{
+		char *line = NULL;
+		size_t llen = 0U;
+		size_t nln = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			nln++;
+			if (LIKELY(line[nrd - 1U] == '\n')) {
+				nrd--;
+			}
+			if (UNLIKELY(scd_ln(line, nrd) < 0)) {
+				fprintf(stderr, "\
+Warning: cannot process line %zu\n", nln);
+				rc = 1;
+			}
+		}
+	}
+	htab_close();
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* tbox-scd.c ends here */
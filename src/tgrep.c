@@ -0,0 +1,239 @@
+/*** tgrep.c -- select lines by Allen relation
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "dt-strpf.h"
+#include "nifty.h"
+
+#define ALLEN(x)	(1U << ECHS_ALLEN_##x)
+#define INTERSECTS							\
+	(ALLEN(OVERLAPS) | ALLEN(FINISHED_BY) | ALLEN(CONTAINS) |	\
+	 ALLEN(STARTS) | ALLEN(EQUALS) | ALLEN(STARTED_BY) |		\
+	 ALLEN(DURING) | ALLEN(FINISHES) | ALLEN(OVERLAPPED_BY))
+#define DISJOINT	(((1U << NECHS_ALLEN) - 1U) & ~INTERSECTS)
+
+static const struct {
+	const char *nam;
+	unsigned int rel;
+} rels[] = {
+	{"before", ALLEN(BEFORE)},
+	{"precedes", ALLEN(BEFORE)},
+	{"meets", ALLEN(MEETS)},
+	{"overlaps", ALLEN(OVERLAPS)},
+	{"finished-by", ALLEN(FINISHED_BY)},
+	{"contains", ALLEN(CONTAINS)},
+	{"starts", ALLEN(STARTS)},
+	{"equals", ALLEN(EQUALS)},
+	{"started-by", ALLEN(STARTED_BY)},
+	{"during", ALLEN(DURING)},
+	{"finishes", ALLEN(FINISHES)},
+	{"overlapped-by", ALLEN(OVERLAPPED_BY)},
+	{"met-by", ALLEN(MET_BY)},
+	{"after", ALLEN(AFTER)},
+	{"preceded-by", ALLEN(AFTER)},
+	{"intersects", INTERSECTS},
+	{"disjoint", DISJOINT},
+};
+
+/* relations we're after */
+static unsigned int relmsk;
+/* the query range, replicated for the batch classifier */
+static echs_range_t qry[64U];
+/* which slot of the VALID, SYSTEM pairs to match */
+static unsigned int sysp;
+static unsigned int invp;
+
+
+static unsigned int
+rel_strp(const char *str)
+{
+	unsigned int res = 0U;
+
+	for (const char *sp = str, *ep; *sp; sp = ep + (*ep == ',')) {
+		size_t i;
+
+		ep = strchr(sp, ',') ?: sp + strlen(sp);
+		for (i = 0U; i < countof(rels); i++) {
+			if (!strncmp(rels[i].nam, sp, ep - sp) &&
+			    !rels[i].nam[ep - sp]) {
+				res |= rels[i].rel;
+				break;
+			}
+		}
+		if (UNLIKELY(i >= countof(rels))) {
+			return 0U;
+		}
+	}
+	return res;
+}
+
+static bool
+classify(const echs_range_t *rng, size_t nrng)
+{
+	echs_allen_t rel[countof(qry)];
+	unsigned int res = 0U;
+
+	echs_range_allen_batch(rel, rng, qry, nrng);
+	for (size_t i = 0U; i < nrng; i++) {
+		res |= 1U << rel[i];
+	}
+	return (res & relmsk) != 0U;
+}
+
+static int
+tgrep_ln(const char *ln, size_t len)
+{
+	echs_range_t rng[countof(qry)];
+	size_t nrng = 0U;
+	size_t wi = 0U;
+	bool matchp = false;
+
+	/* allow prefixes */
+	with (const char *wp = memchr(ln, '\t', len)) {
+		if (wp != NULL) {
+			wi += ++wp - ln;
+		}
+	}
+
+	/* read them intervals */
+	while (wi < len && !matchp) {
+		echs_range_t r[2U];
+		char *eo = NULL;
+
+		for (; wi < len && (isspace(ln[wi]) || ln[wi] == ';'); wi++);
+		r[0U] = range_strp(ln + wi, &eo, len - wi);
+		if (UNLIKELY(eo == NULL)) {
+			break;
+		}
+		wi = eo - ln;
+		r[1U] = echs_max_range();
+		if (wi < len && ln[wi] == ',') {
+			for (wi++; wi < len && isspace(ln[wi]); wi++);
+			eo = NULL;
+			r[1U] = range_strp(ln + wi, &eo, len - wi);
+			if (UNLIKELY(eo == NULL)) {
+				break;
+			}
+			wi = eo - ln;
+		}
+		rng[nrng++] = echs_range_unfix(r[sysp]);
+
+		if (nrng >= countof(rng)) {
+			matchp = classify(rng, nrng);
+			nrng = 0U;
+		}
+	}
+	if (nrng) {
+		matchp = matchp || classify(rng, nrng);
+	}
+
+	if (matchp ^ invp) {
+		fwrite(ln, 1, len, stdout);
+		fputc('\n', stdout);
+	}
+	return matchp;
+}
+
+
+#include "tgrep.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	} else if (argi->nargs != 2U) {
+		yuck_auto_help(argi);
+		rc = 1;
+		goto out;
+	}
+
+	if (!(relmsk = rel_strp(argi->args[0U]))) {
+		fprintf(stderr, "\
+Error: cannot parse relation `%s'\n", argi->args[0U]);
+		rc = 1;
+		goto out;
+	}
+	with (char *eo = NULL) {
+		const char *s = argi->args[1U];
+		echs_range_t q = range_strp(s, &eo, strlen(s));
+
+		if (UNLIKELY(eo == NULL || *eo)) {
+			fprintf(stderr, "\
+Error: cannot parse range `%s'\n", s);
+			rc = 1;
+			goto out;
+		}
+		q = echs_range_unfix(q);
+		for (size_t i = 0U; i < countof(qry); i++) {
+			qry[i] = q;
+		}
+	}
+	sysp = argi->system_flag;
+	invp = argi->invert_match_flag;
+
+	/* grep semantics, 0 if something was selected, 1 otherwise */
+	rc = 1;
+	{
+		char *line = NULL;
+		size_t llen = 0U;
+
+		for (ssize_t nrd; (nrd = getline(&line, &llen, stdin)) > 0;) {
+			if (LIKELY(line[nrd - 1U] == '\n')) {
+				nrd--;
+			}
+			if (tgrep_ln(line, nrd) ^ invp) {
+				rc = 0;
+			}
+		}
+	}
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* tgrep.c ends here */
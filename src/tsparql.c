@@ -0,0 +1,450 @@
+/*** tsparql.c -- rewrite temporal SPARQL filters to GeoSPARQL
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "dt-strpf.h"
+#include "box.h"
+#include "nifty.h"
+
+#define GEOF_INTERSECTS	\
+	"<http://www.opengis.net/def/function/geosparql/sfIntersects>"
+#define GEO_WKTLITERAL	"<http://www.opengis.net/ont/geosparql#wktLiteral>"
+#define XSD_DATETIME	"<http://www.w3.org/2001/XMLSchema#dateTime>"
+
+typedef struct {
+	const char *s;
+	size_t n;
+} var_t;
+
+/* range variables, VAL FROM, VAL TILL, SYS FROM, SYS TILL, sans sigil */
+static var_t rvar[2U][2U] = {
+	{{"vfrom", 5U}, {"vtill", 5U}},
+	{{"sfrom", 5U}, {"still", 5U}},
+};
+/* geometry variable, with sigil */
+static const char *gvar = "?wkt";
+
+
+/* lexer, strings, IRIs and comments are skipped as a whole */
+static size_t
+lex_skip(const char *s, size_t n, size_t i)
+{
+	switch (s[i]) {
+	case '#':
+		for (i++; i < n && s[i] != '\n'; i++);
+		return i;
+	case '"':
+	case '\'': {
+		const char q = s[i];
+
+		if (i + 2U < n && s[i + 1U] == q && s[i + 2U] == q) {
+			/* long string */
+			for (i += 3U; i + 2U < n; i++) {
+				if (s[i] == '\\') {
+					i++;
+				} else if (s[i] == q &&
+					   s[i + 1U] == q && s[i + 2U] == q) {
+					return i + 3U;
+				}
+			}
+			return n;
+		}
+		for (i++; i < n && s[i] != q; i++) {
+			i += s[i] == '\\';
+		}
+		return i < n ? i + 1U : n;
+	}
+	case '<': {
+		/* IRIs have no whitespace, otherwise it's less-than */
+		size_t j = i + 1U;
+
+		for (; j < n && !strchr(" \t\r\n<>\"{}|^`\\", s[j]); j++);
+		return j < n && s[j] == '>' ? j + 1U : i + 1U;
+	}
+	case '?':
+	case '$':
+		/* variables, so ?filter isn't taken for a keyword */
+		for (i++; i < n && (isalnum(s[i]) || s[i] == '_'); i++);
+		return i;
+	default:
+		break;
+	}
+	return i + 1U;
+}
+
+static size_t
+lex_close(const char *s, size_t n, size_t i)
+{
+/* find the parenthesis closing the one at I, or N */
+	size_t depth = 0U;
+
+	for (; i < n; i = lex_skip(s, n, i)) {
+		if (s[i] == '(') {
+			depth++;
+		} else if (s[i] == ')' && !--depth) {
+			return i;
+		}
+	}
+	return n;
+}
+
+
+/* filter terms */
+static size_t
+term_var(int var[static 2U], const char *s, size_t n)
+{
+	size_t i = 1U;
+
+	if (!n || (*s != '?' && *s != '$')) {
+		return 0U;
+	}
+	for (; i < n && (isalnum(s[i]) || s[i] == '_'); i++);
+	for (size_t d = 0U; d < 2U; d++) {
+		for (size_t e = 0U; e < 2U; e++) {
+			if (rvar[d][e].n == i - 1U &&
+			    !memcmp(rvar[d][e].s, s + 1U, i - 1U)) {
+				var[0U] = d;
+				var[1U] = e;
+				return i;
+			}
+		}
+	}
+	return 0U;
+}
+
+static size_t
+term_lit(echs_instant_t *t, const char *s, size_t n)
+{
+	static const char xsd[] = "xsd:dateTime";
+	const char *q;
+	char *on = NULL;
+	size_t i;
+
+	if (n < 2U || *s != '"' || (q = memchr(s + 1U, '"', n - 1U)) == NULL) {
+		return 0U;
+	}
+	*t = dt_strp(s + 1U, &on, q - s - 1U);
+	if (echs_nul_instant_p(*t) || on != q || t->H == ECHS_ALL_DAY) {
+		return 0U;
+	}
+	/* literals are instants, not seconds */
+	if (t->ms == ECHS_ALL_SEC) {
+		t->ms = 0U;
+	}
+	i = q + 1U - s;
+	if (i + 2U > n || s[i] != '^' || s[i + 1U] != '^') {
+		return 0U;
+	}
+	i += 2U;
+	if (n - i >= strlenof(xsd) && !memcmp(s + i, xsd, strlenof(xsd))) {
+		return i + strlenof(xsd);
+	} else if (n - i >= strlenof(XSD_DATETIME) &&
+		   !memcmp(s + i, XSD_DATETIME, strlenof(XSD_DATETIME))) {
+		return i + strlenof(XSD_DATETIME);
+	}
+	return 0U;
+}
+
+static int
+term(echs_instant_t bnd[static 2U][2U], const char *s, size_t n)
+{
+/* ?FROM < T, ?FROM <= T, ?TILL > T, ?TILL >= T, or mirrored */
+	static const echs_idiff_t succ = {0, 1U};
+	static const echs_idiff_t pred = {-1, MSECS_PER_DAY - 1U};
+	echs_instant_t t;
+	int var[2U];
+	bool litp;
+	size_t i, k;
+	char op[2U] = {'\0', '\0'};
+
+	/* trim whitespace and redundant parentheses */
+	for (;;) {
+		for (; n && isspace(*s); s++, n--);
+		for (; n && isspace(s[n - 1U]); n--);
+		if (!n || *s != '(' || lex_close(s, n, 0U) != n - 1U) {
+			break;
+		}
+		s++, n -= 2U;
+	}
+	if ((i = term_var(var, s, n))) {
+		litp = false;
+	} else if ((i = term_lit(&t, s, n))) {
+		litp = true;
+	} else {
+		return -1;
+	}
+	for (; i < n && isspace(s[i]); i++);
+	if (i < n && (s[i] == '<' || s[i] == '>')) {
+		op[0U] = s[i++];
+		if (i < n && s[i] == '=') {
+			op[1U] = s[i++];
+		}
+	} else {
+		return -1;
+	}
+	for (; i < n && isspace(s[i]); i++);
+	if (litp) {
+		k = term_var(var, s + i, n - i);
+		/* mirror */
+		op[0U] ^= '<' ^ '>';
+	} else {
+		k = term_lit(&t, s + i, n - i);
+	}
+	if (!k || i + k < n) {
+		return -1;
+	}
+
+	if (!var[1U]) {
+		/* FROM before T, upper bound of the query range */
+		if (op[0U] != '<') {
+			return -1;
+		} else if (op[1U]) {
+			t = echs_instant_add(t, succ);
+		}
+		if (echs_instant_lt_p(t, bnd[var[0U]][1U])) {
+			bnd[var[0U]][1U] = t;
+		}
+	} else {
+		/* TILL after T, lower bound of the query range */
+		if (op[0U] != '>') {
+			return -1;
+		} else if (op[1U]) {
+			t = echs_instant_add(t, pred);
+		}
+		if (echs_instant_lt_p(bnd[var[0U]][0U], t)) {
+			bnd[var[0U]][0U] = t;
+		}
+	}
+	return 0;
+}
+
+static int
+filt(echs_box_t *q, const char *s, size_t n)
+{
+/* conjunctions of terms */
+	echs_instant_t bnd[2U][2U] = {
+		{echs_min_instant(), echs_max_instant()},
+		{echs_min_instant(), echs_max_instant()},
+	};
+	size_t beg = 0U;
+	size_t depth = 0U;
+
+	for (size_t i = 0U;;) {
+		if (i >= n ||
+		    (!depth && s[i] == '&' && i + 1U < n && s[i + 1U] == '&')) {
+			if (term(bnd, s + beg, i - beg) < 0) {
+				return -1;
+			} else if (i >= n) {
+				break;
+			}
+			beg = i += 2U;
+			continue;
+		}
+		depth += s[i] == '(';
+		depth -= s[i] == ')';
+		i = lex_skip(s, n, i);
+	}
+	with (const echs_range_t vr = {bnd[0U][0U], bnd[0U][1U]},
+	      sr = {bnd[1U][0U], bnd[1U][1U]}) {
+		*q = echs_range_qbox(vr, sr);
+		if (UNLIKELY(q->from[0U] > q->to[0U] ||
+			     q->from[1U] > q->to[1U])) {
+			/* containment rather than overlap,
+			 * leave it to the endpoint */
+			return -1;
+		} else if (UNLIKELY(!echs_range_qbox_exact_p(*q, vr, sr))) {
+			/* the window is a mere prefilter */
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void
+rewr(const char *s, size_t n)
+{
+	size_t last = 0U;
+
+	for (size_t i = 0U; i < n;) {
+		size_t j = i;
+		size_t k;
+		echs_box_t q;
+
+		if (!isalpha(s[i])) {
+			i = lex_skip(s, n, i);
+			continue;
+		}
+		/* words, prefixed names included */
+		for (; j < n && (isalnum(s[j]) || strchr("_-:.", s[j])); j++);
+		if (j - i != 6U || strncasecmp(s + i, "FILTER", 6U)) {
+			i = j;
+			continue;
+		}
+		for (k = j; k < n && isspace(s[k]); k++);
+		if (k < n && s[k] == '(') {
+			const size_t e = lex_close(s, n, k);
+			int r;
+
+			if (e < n &&
+			    (r = filt(&q, s + k + 1U, e - k - 1U)) >= 0) {
+				char buf[256U];
+
+				fwrite(s + last, 1, i - last, stdout);
+				fputs("FILTER(" GEOF_INTERSECTS "(", stdout);
+				fputs(gvar, stdout);
+				fputs(", \"", stdout);
+				fwrite(buf, 1, qbox_strf(buf, sizeof(buf), q),
+				       stdout);
+				fputs("\"^^" GEO_WKTLITERAL ")", stdout);
+				if (r) {
+					/* keep the original to decide */
+					fputs(" && (", stdout);
+					fwrite(s + k + 1U, 1, e - k - 1U, stdout);
+					fputc(')', stdout);
+				}
+				fputc(')', stdout);
+				last = j = e + 1U;
+			}
+		}
+		i = j;
+	}
+	fwrite(s + last, 1, n - last, stdout);
+	return;
+}
+
+
+static int
+var_strp(var_t v[static 2U], const char *s)
+{
+	const char *c = strchr(s, ',');
+
+	if (UNLIKELY(c == NULL)) {
+		return -1;
+	}
+	s += *s == '?' || *s == '$';
+	v[0U] = (var_t){s, c - s};
+	c++;
+	c += *c == '?' || *c == '$';
+	v[1U] = (var_t){c, strlen(c)};
+	return -(!v[0U].n || !v[1U].n);
+}
+
+
+#include "tsparql.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	char *buf = NULL;
+	size_t bsz = 0U;
+	size_t bi = 0U;
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->valid_arg && UNLIKELY(var_strp(rvar[0U], argi->valid_arg) < 0)) {
+		fprintf(stderr, "\
+Error: cannot parse variables `%s'\n", argi->valid_arg);
+		rc = 1;
+		goto out;
+	}
+	if (argi->system_arg &&
+	    UNLIKELY(var_strp(rvar[1U], argi->system_arg) < 0)) {
+		fprintf(stderr, "\
+Error: cannot parse variables `%s'\n", argi->system_arg);
+		rc = 1;
+		goto out;
+	}
+	if (argi->geometry_arg) {
+		const char *g = argi->geometry_arg;
+
+		if (UNLIKELY(*g != '?' && *g != '$')) {
+			fprintf(stderr, "\
+Error: geometry variable `%s' must start with ? or $\n", g);
+			rc = 1;
+			goto out;
+		}
+		gvar = g;
+	}
+	with (echs_boxmap_t m = echs_box_defmap) {
+		if (UNLIKELY(echs_boxmap_strp(
+				     &m, argi->epoch_arg, argi->scale_arg,
+				     argi->warp_arg) < 0)) {
+			fprintf(stderr, "\
+Error: cannot parse epoch, scale or warp\n");
+			rc = 1;
+			goto out;
+		}
+		echs_box_setmap(m);
+	}
+
+	/* queries are small, take them in as a whole */
+	for (size_t nrd;; bi += nrd) {
+		if (UNLIKELY(bi >= bsz)) {
+			const size_t nuz = (bsz * 2U) ?: 65536U;
+			char *nu = realloc(buf, nuz);
+
+			if (UNLIKELY(nu == NULL)) {
+				rc = 1;
+				goto out;
+			}
+			buf = nu;
+			bsz = nuz;
+		}
+		if (!(nrd = fread(buf + bi, 1, bsz - bi, stdin))) {
+			break;
+		}
+	}
+	rewr(buf, bi);
+
+out:
+	free(buf);
+	yuck_free(argi);
+	return rc;
+}
+
+/* tsparql.c ends here */
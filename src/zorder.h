@@ -0,0 +1,63 @@
+/*** zorder.h -- Morton (Z-order) indices
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_zorder_h_
+#define INCLUDED_zorder_h_
+#include <stdint.h>
+
+static inline __attribute__((const, pure)) uint64_t
+echs_morton_spread(uint32_t v)
+{
+	uint64_t x = v;
+
+	x = (x | x << 16U) & 0x0000ffff0000ffffULL;
+	x = (x | x << 8U) & 0x00ff00ff00ff00ffULL;
+	x = (x | x << 4U) & 0x0f0f0f0f0f0f0f0fULL;
+	x = (x | x << 2U) & 0x3333333333333333ULL;
+	x = (x | x << 1U) & 0x5555555555555555ULL;
+	return x;
+}
+
+/**
+ * Return the Morton index of cell (X, Y), i.e. the bits of X and Y
+ * interleaved with X in the even and Y in the odd bit positions. */
+static inline __attribute__((const, pure)) uint64_t
+echs_morton(uint32_t x, uint32_t y)
+{
+	return echs_morton_spread(x) | echs_morton_spread(y) << 1U;
+}
+
+#endif	/* INCLUDED_zorder_h_ */
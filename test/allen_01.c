@@ -0,0 +1,193 @@
+/*** allen_01.c -- batch Allen classifier against the scalar one
+ *
+ * Copyright (C) 2016 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of geo2tsparql.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "range.h"
+#include "dt-strpf.h"
+#include "nifty.h"
+
+static const char *const rels[] = {
+	[ECHS_ALLEN_BEFORE] = "before",
+	[ECHS_ALLEN_MEETS] = "meets",
+	[ECHS_ALLEN_OVERLAPS] = "overlaps",
+	[ECHS_ALLEN_FINISHED_BY] = "finished-by",
+	[ECHS_ALLEN_CONTAINS] = "contains",
+	[ECHS_ALLEN_STARTS] = "starts",
+	[ECHS_ALLEN_EQUALS] = "equals",
+	[ECHS_ALLEN_STARTED_BY] = "started-by",
+	[ECHS_ALLEN_DURING] = "during",
+	[ECHS_ALLEN_FINISHES] = "finishes",
+	[ECHS_ALLEN_OVERLAPPED_BY] = "overlapped-by",
+	[ECHS_ALLEN_MET_BY] = "met-by",
+	[ECHS_ALLEN_AFTER] = "after",
+};
+
+/* pairs of ranges A, B and the relation of A to B,
+ * a missing beginning or end stands for the open one */
+static const struct {
+	const char *ab, *ae;
+	const char *bb, *be;
+	echs_allen_t rel;
+} tst[] = {
+	/* all-day ranges, the end day is included */
+	{"2016-01-01", "2016-01-03", "2016-01-05", "2016-01-09",
+	 ECHS_ALLEN_BEFORE},
+	{"2016-01-01", "2016-01-04", "2016-01-05", "2016-01-09",
+	 ECHS_ALLEN_MEETS},
+	{"2016-01-01", "2016-01-05", "2016-01-03", "2016-01-09",
+	 ECHS_ALLEN_OVERLAPS},
+	{"2016-01-01", "2016-01-09", "2016-01-03", "2016-01-09",
+	 ECHS_ALLEN_FINISHED_BY},
+	{"2016-01-01", "2016-01-09", "2016-01-03", "2016-01-05",
+	 ECHS_ALLEN_CONTAINS},
+	{"2016-01-01", "2016-01-05", "2016-01-01", "2016-01-09",
+	 ECHS_ALLEN_STARTS},
+	{"2016-01-01", "2016-01-09", "2016-01-01", "2016-01-09",
+	 ECHS_ALLEN_EQUALS},
+	{"2016-01-01", "2016-01-09", "2016-01-01", "2016-01-05",
+	 ECHS_ALLEN_STARTED_BY},
+	{"2016-01-03", "2016-01-05", "2016-01-01", "2016-01-09",
+	 ECHS_ALLEN_DURING},
+	{"2016-01-03", "2016-01-09", "2016-01-01", "2016-01-09",
+	 ECHS_ALLEN_FINISHES},
+	{"2016-01-03", "2016-01-09", "2016-01-01", "2016-01-05",
+	 ECHS_ALLEN_OVERLAPPED_BY},
+	{"2016-01-05", "2016-01-09", "2016-01-01", "2016-01-04",
+	 ECHS_ALLEN_MET_BY},
+	{"2016-01-05", "2016-01-09", "2016-01-01", "2016-01-03",
+	 ECHS_ALLEN_AFTER},
+
+	/* time of day against all-day */
+	{"2016-01-01T10:00:00", "2016-01-01T12:00:00",
+	 "2016-01-01", "2016-01-01",
+	 ECHS_ALLEN_DURING},
+	{"2016-01-01", "2016-01-01",
+	 "2016-01-02T00:00:00", "2016-01-02T12:00:00",
+	 ECHS_ALLEN_MEETS},
+	{"2016-01-01T00:00:00", "2016-01-01T23:59:59",
+	 "2016-01-01", "2016-01-01",
+	 ECHS_ALLEN_EQUALS},
+	{"2016-01-01T12:00:00", "2016-01-02T12:00:00",
+	 "2016-01-01", "2016-01-01",
+	 ECHS_ALLEN_OVERLAPPED_BY},
+
+	/* open ends */
+	{"2016-01-01", NULL, "2016-01-03", NULL,
+	 ECHS_ALLEN_FINISHED_BY},
+	{"2016-01-03", NULL, "2016-01-01", NULL,
+	 ECHS_ALLEN_FINISHES},
+	{"2016-01-01", NULL, "2016-01-01", NULL,
+	 ECHS_ALLEN_EQUALS},
+	{"2016-01-01", NULL, "2016-01-03", "2016-01-05",
+	 ECHS_ALLEN_CONTAINS},
+	{"2016-01-05", NULL, "2016-01-01", "2016-01-03",
+	 ECHS_ALLEN_AFTER},
+	{"2016-01-05", NULL, "2016-01-01", "2016-01-04",
+	 ECHS_ALLEN_MET_BY},
+	{"2016-01-01", "2016-01-03", "2016-01-05", NULL,
+	 ECHS_ALLEN_BEFORE},
+	{NULL, "2016-01-03", "2016-01-01", "2016-01-09",
+	 ECHS_ALLEN_OVERLAPS},
+	{NULL, "2016-01-03", NULL, "2016-01-09",
+	 ECHS_ALLEN_STARTS},
+	{NULL, NULL, "2016-01-01", "2016-01-09",
+	 ECHS_ALLEN_CONTAINS},
+	{NULL, NULL, NULL, NULL,
+	 ECHS_ALLEN_EQUALS},
+};
+
+
+static echs_instant_t
+rd(const char *s, echs_instant_t dflt)
+{
+	return s != NULL ? dt_strp(s, NULL, strlen(s)) : dflt;
+}
+
+static echs_range_t
+rd_range(const char *b, const char *e)
+{
+	echs_range_t r = {
+		rd(b, echs_min_instant()),
+		rd(e, echs_max_instant()),
+	};
+	return echs_range_unfix(r);
+}
+
+
+int
+main(void)
+{
+	static echs_range_t a[countof(tst)];
+	static echs_range_t b[countof(tst)];
+	static echs_allen_t rel[countof(tst)];
+	int rc = 0;
+
+	for (size_t i = 0U; i < countof(tst); i++) {
+		a[i] = rd_range(tst[i].ab, tst[i].ae);
+		b[i] = rd_range(tst[i].bb, tst[i].be);
+	}
+	/* start at every offset so that each pair passes through
+	 * every vector lane as well as the scalar tail */
+	for (size_t o = 0U; o < 4U; o++) {
+		memset(rel, -1, sizeof(rel));
+		echs_range_allen_batch(rel + o, a + o, b + o, countof(tst) - o);
+		for (size_t i = o; i < countof(tst); i++) {
+			const echs_allen_t s = echs_range_allen(a[i], b[i]);
+
+			if (s != tst[i].rel) {
+				fprintf(stderr, "\
+pair %zu: scalar says %s, expected %s\n",
+					i, rels[s], rels[tst[i].rel]);
+				rc = 1;
+			}
+			if (rel[i] != s) {
+				fprintf(stderr, "\
+pair %zu, offset %zu: batch says %s, scalar says %s\n",
+					i, o, (unsigned int)rel[i] < NECHS_ALLEN
+					? rels[rel[i]] : "nothing", rels[s]);
+				rc = 1;
+			}
+		}
+	}
+	return rc;
+}
+
+/* allen_01.c ends here */